@@ -0,0 +1,235 @@
+/* btree.c
+ * Árbol B+ de index.bin (ver btree.h): carga masiva al construir el índice
+ * y recorrido ordenado sobre la proyección en memoria.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btree.h"
+
+#define ENTRY_OVERHEAD (2 + sizeof(uint64_t))
+
+/* --- construcción --- */
+
+int btree_add(BtreeBuilder *b, const char *norm, long csv_offset) {
+    size_t len = strnlen(norm, KEY_SIZE - 1);
+    if (b->keys_used + len + 1 > b->keys_cap) {
+        size_t cap = b->keys_cap ? b->keys_cap * 2 : 1 << 20;
+        while (cap < b->keys_used + len + 1) cap *= 2;
+        char *nk = realloc(b->keys, cap);
+        if (!nk) return -1;
+        b->keys = nk;
+        b->keys_cap = cap;
+    }
+    if (b->n == b->cap) {
+        long cap = b->cap ? b->cap * 2 : 1 << 16;
+        void *nr = realloc(b->recs, sizeof(*b->recs) * (size_t)cap);
+        if (!nr) return -1;
+        b->recs = nr;
+        b->cap = cap;
+    }
+    memcpy(b->keys + b->keys_used, norm, len);
+    b->keys[b->keys_used + len] = '\0';
+    b->recs[b->n].key = b->keys_used;
+    b->recs[b->n].csv_offset = csv_offset;
+    b->n++;
+    b->keys_used += len + 1;
+    return 0;
+}
+
+void btree_free(BtreeBuilder *b) {
+    free(b->keys);
+    free(b->recs);
+    memset(b, 0, sizeof(*b));
+}
+
+/* Entrada de un nivel: clave y valor (offset en el CSV o página del hijo). */
+typedef struct {
+    const char *key;
+    uint64_t value;
+} Item;
+
+static int cmp_item(const void *a, const void *b) {
+    const Item *x = a, *y = b;
+    int c = strcmp(x->key, y->key);
+    if (c) return c;
+    return (x->value > y->value) - (x->value < y->value);
+}
+
+/* Empaqueta los n items en nodos llenos a partir de la página *page_no y
+ * devuelve en *parents la primera clave de cada nodo (el nivel de arriba). */
+static int write_level(FILE *idx, const Item *items, long n, int leaf, uint32_t *page_no,
+                       Item **parents, long *n_parents) {
+    char page[BTREE_PAGE];
+    long cap = n / 16 + 1, np = 0;
+    Item *up = malloc(sizeof(Item) * (size_t)cap);
+    if (!up) return -1;
+
+    long i = 0;
+    do {
+        memset(page, 0, sizeof(page));
+        BtreeNode *node = (BtreeNode *)page;
+        node->leaf = (uint8_t)leaf;
+        size_t pos = sizeof(BtreeNode);
+        const char *prev = "";
+        if (np == cap) {
+            Item *nu = realloc(up, sizeof(Item) * (size_t)(cap *= 2));
+            if (!nu) { free(up); return -1; }
+            up = nu;
+        }
+        up[np].key = i < n ? items[i].key : "";
+        up[np].value = *page_no;
+        np++;
+        for (; i < n && node->n < UINT16_MAX; ++i) {
+            const char *k = items[i].key;
+            size_t shared = 0, len = strlen(k);
+            while (shared < 255 && prev[shared] && prev[shared] == k[shared]) shared++;
+            size_t rest = len - shared;
+            if (pos + ENTRY_OVERHEAD + rest > BTREE_PAGE) break;
+            page[pos] = (char)shared;
+            page[pos + 1] = (char)rest;
+            memcpy(page + pos + 2, k + shared, rest);
+            memcpy(page + pos + 2 + rest, &items[i].value, sizeof(uint64_t));
+            pos += ENTRY_OVERHEAD + rest;
+            node->n++;
+            prev = k;
+        }
+        node->next = leaf && i < n ? *page_no + 1 : BTREE_NONE;
+        if (fwrite(page, sizeof(page), 1, idx) != 1) { free(up); return -1; }
+        (*page_no)++;
+    } while (i < n);
+
+    *parents = up;
+    *n_parents = np;
+    return 0;
+}
+
+int btree_write(BtreeBuilder *b, FILE *idx, IndexHeader *header) {
+    Item *items = malloc(sizeof(Item) * (size_t)(b->n ? b->n : 1));
+    if (!items) return -1;
+    for (long i = 0; i < b->n; ++i) {
+        items[i].key = b->keys + b->recs[i].key;
+        items[i].value = (uint64_t)b->recs[i].csv_offset;
+    }
+    qsort(items, (size_t)b->n, sizeof(Item), cmp_item);
+
+    /* página 0 alineada: cada nodo cae en una sola página del sistema */
+    if (fseek(idx, 0, SEEK_END) != 0) { free(items); return -1; }
+    long end = ftell(idx);
+    long start = (end + BTREE_PAGE - 1) / BTREE_PAGE * BTREE_PAGE;
+    for (long pad = end; pad < start; ++pad)
+        if (fputc(0, idx) == EOF) { free(items); return -1; }
+
+    uint32_t page_no = 0;
+    int height = 0, rc = 0;
+    long n = b->n;
+    Item *level = items;
+    for (;;) {
+        Item *up = NULL;
+        long n_up = 0;
+        rc = write_level(idx, level, n, height == 0, &page_no, &up, &n_up);
+        if (level != items) free(level);
+        height++;
+        if (rc != 0) break;
+        level = up;
+        n = n_up;
+        if (n == 1) {
+            header->btree_root = (long)up[0].value;
+            free(up);
+            break;
+        }
+    }
+    free(items);
+    if (rc != 0) return -1;
+
+    header->offset_btree = start;
+    header->btree_page = BTREE_PAGE;
+    header->btree_height = height;
+    header->btree_pages = page_no;
+    return 0;
+}
+
+/* --- consulta --- */
+
+static const char *page_at(const IndexMap *m, long no) {
+    const IndexHeader *h = m->header;
+    if (no < 0 || no >= h->btree_pages) return NULL;
+    return m->idx + h->offset_btree + no * (long)h->btree_page;
+}
+
+/* Decodifica la entrada en pos sobre key (la anterior del nodo). Devuelve la
+ * posición de la siguiente, o 0 si el nodo está dañado. */
+static size_t decode(const char *page, size_t page_sz, size_t pos, char *key, size_t *key_len,
+                     uint64_t *value) {
+    if (pos + ENTRY_OVERHEAD > page_sz) return 0;
+    size_t shared = (uint8_t)page[pos], rest = (uint8_t)page[pos + 1];
+    if (shared > *key_len || shared + rest >= KEY_SIZE || pos + ENTRY_OVERHEAD + rest > page_sz) return 0;
+    memcpy(key + shared, page + pos + 2, rest);
+    *key_len = shared + rest;
+    key[*key_len] = '\0';
+    memcpy(value, page + pos + 2 + rest, sizeof(uint64_t));
+    return pos + ENTRY_OVERHEAD + rest;
+}
+
+static int enter_leaf(BtreeCursor *c, const char *page) {
+    const BtreeNode *node = (const BtreeNode *)page;
+    c->pages++;
+    if (!page || !node->leaf) { c->page = NULL; return -1; }
+    c->page = page;
+    c->pos = sizeof(BtreeNode);
+    c->left = node->n;
+    c->key_len = 0;
+    return 0;
+}
+
+int btree_seek(BtreeCursor *c, const IndexMap *m, const char *key) {
+    memset(c, 0, sizeof(*c));
+    c->m = m;
+    const IndexHeader *h = m->header;
+    if (h->index_type != INDEX_TYPE_BTREE) return -1;
+
+    /* en cada nivel, el último hijo cuya primera clave es < key: los títulos
+     * repetidos pueden empezar al final del hijo anterior */
+    long no = h->btree_root;
+    for (int level = h->btree_height; level > 1; --level) {
+        const char *page = page_at(m, no);
+        if (!page || ((const BtreeNode *)page)->leaf) return -1;
+        c->pages++;
+        const BtreeNode *node = (const BtreeNode *)page;
+        char k[KEY_SIZE];
+        size_t k_len = 0, pos = sizeof(BtreeNode);
+        uint64_t v, child = BTREE_NONE;
+        for (int i = 0; i < node->n; ++i) {
+            if (!(pos = decode(page, (size_t)h->btree_page, pos, k, &k_len, &v))) return -1;
+            if (i > 0 && strcmp(k, key) >= 0) break;
+            child = v;
+        }
+        if (child == BTREE_NONE) return -1;
+        no = (long)child;
+    }
+    const char *leaf = page_at(m, no);
+    if (!leaf || enter_leaf(c, leaf) != 0) return -1;
+
+    while (btree_next(c))
+        if (strcmp(c->key, key) >= 0) { c->pending = 1; break; }
+    return 0;
+}
+
+int btree_next(BtreeCursor *c) {
+    if (c->pending) { c->pending = 0; return 1; }
+    if (!c->page) return 0;
+    while (c->left == 0) {
+        uint32_t next = ((const BtreeNode *)c->page)->next;
+        const char *page = next == BTREE_NONE ? NULL : page_at(c->m, next);
+        if (!page || enter_leaf(c, page) != 0) { c->page = NULL; return 0; }
+    }
+    uint64_t value;
+    c->pos = decode(c->page, (size_t)c->m->header->btree_page, c->pos, c->key, &c->key_len, &value);
+    if (!c->pos) { c->page = NULL; return 0; }
+    c->left--;
+    c->csv_offset = (long)value;
+    return 1;
+}
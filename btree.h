@@ -0,0 +1,73 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "index.h"
+
+/* Árbol B+ de index.bin (INDEX_TYPE_BTREE) sobre los títulos normalizados
+ * (hash_normalize), para lo que los buckets no pueden: títulos que empiezan
+ * con un prefijo, rangos de títulos y resultados en orden de título.
+ *
+ * Se carga de una vez al construir el índice (build_index): los registros se
+ * ordenan por título y se empaquetan en hojas llenas, y cada nivel interno
+ * guarda la primera clave de cada hijo. Los nodos ocupan una página de
+ * BTREE_PAGE bytes, alineada en el archivo; las hojas quedan contiguas y
+ * enlazadas, así un recorrido ordenado lee páginas seguidas. Dentro de un
+ * nodo las claves van con codificación de prefijos: cada una guarda cuántos
+ * bytes comparte con la anterior y el resto. */
+
+#define BTREE_PAGE 4096
+#define BTREE_NONE UINT32_MAX
+
+/* Cabecera de cada nodo; le siguen n entradas
+ * [compartidos u8][largo del resto u8][resto][valor u64]
+ * con valor = offset en el CSV (hojas) o página del hijo (internos). */
+typedef struct {
+    uint8_t leaf;
+    uint8_t pad;
+    uint16_t n;
+    uint32_t next;              /* hoja siguiente; BTREE_NONE en la última */
+} BtreeNode;
+
+/* --- construcción (build_index) --- */
+
+typedef struct {
+    char *keys;                 /* títulos normalizados, terminados en '\0' */
+    size_t keys_used, keys_cap;
+    struct { size_t key; long csv_offset; } *recs;
+    long n, cap;
+} BtreeBuilder;
+
+/* Agrega un registro. 0, o -1 sin memoria. */
+int btree_add(BtreeBuilder *b, const char *norm, long csv_offset);
+
+/* Escribe el árbol al final de idx (alineado a BTREE_PAGE) y completa los
+ * campos btree_* de header. 0, o -1. */
+int btree_write(BtreeBuilder *b, FILE *idx, IndexHeader *header);
+void btree_free(BtreeBuilder *b);
+
+/* --- consulta --- */
+
+typedef struct {
+    const IndexMap *m;
+    const char *page;           /* hoja actual, NULL al terminar */
+    size_t pos;                 /* próxima entrada dentro de la hoja */
+    int left;                   /* entradas que quedan en la hoja */
+    int pending;                /* btree_seek dejó una entrada sin entregar */
+    long pages;                 /* nodos leídos */
+    char key[KEY_SIZE];         /* entrada actual */
+    size_t key_len;
+    long csv_offset;
+} BtreeCursor;
+
+/* Posiciona c en la primera clave >= key. 0, o -1 si el índice no tiene
+ * árbol o está dañado. */
+int btree_seek(BtreeCursor *c, const IndexMap *m, const char *key);
+
+/* Avanza a la entrada siguiente en orden (c->key, c->csv_offset): 1, o 0
+ * al pasar la última. */
+int btree_next(BtreeCursor *c);
+
+#endif
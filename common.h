@@ -2,6 +2,8 @@
 #define COMMON_H
 #define FIFO_REQ "/tmp/p1_req"
 #define FIFO_RES "/tmp/p1_res"
+#define SOCK_PATH "/tmp/p1_sock"   /* socket UNIX (mismo protocolo binario) */
+#define READY_FILE "/tmp/p1_ready" /* lo crea el daemon (con su pid) al estar listo */
 
 // Mensaje que la UI envia al daemon
 typedef struct {
@@ -9,12 +11,80 @@ typedef struct {
     char value1[256];
     char field_name2[64];  // vacio si no se usa
     char value2[256];
+    int timeout_ms;        // 0: sin plazo propio (se usa el del daemon, -T)
+    int flags;             // REQ_*
 } Request;
 
+/* Request.flags (en un lote, los de la cabecera valen para todas) */
+#define REQ_TIMING 0x1     /* devolver el desglose por etapas en Response.stage_us */
+#define REQ_EXACT  0x2     /* título completo, no subcadena: se compara la forma
+                            * normalizada (hash_normalize) y sólo se recorre el
+                            * bucket de la clave */
+#define REQ_PREFIX 0x4     /* títulos que empiezan con el valor (normalizado), en
+                            * orden de título; requiere el árbol B+ (-b) */
+#define REQ_RANGE  0x8     /* títulos normalizados en [title, title_to), en
+                            * orden; title_to va en el otro campo ("" o ausente:
+                            * hasta el final). Requiere el árbol B+ */
+#define REQ_FUZZY  0x10    /* títulos a distancia de edición <= max_edits del
+                            * valor (normalizados), los más cercanos primero;
+                            * max_edits va en el otro campo (vacío o ausente:
+                            * FUZZY_K). Requiere el trie de títulos (-A) */
+#define FUZZY_K 2
+#define REQ_COUNT  0x20    /* búsqueda por subcadena que sólo cuenta: result =
+                            * "COUNT titles=N occurrences=M" sin leer el CSV
+                            * (no aplica update_date). Requiere el arreglo de
+                            * sufijos (-U) */
+
+/* Etapas de una consulta: índices de Response.stage_us y de los histogramas
+ * del daemon (stats.c). */
+enum { STAGE_PARSE, STAGE_OPEN, STAGE_WALK, STAGE_MATCH, STAGE_FETCH, STAGE_FILTER, STAGE_WRITE, N_STAGES };
+
+/* Lote de consultas: una Request cabecera con field_name1 = BATCH_TAG y
+ * value1 = N (en decimal), seguida de N Request normales (una por consulta).
+ * Un timeout_ms en la cabecera se aplica a las consultas que no traen uno.
+ * El daemon las resuelve juntas en una sola pasada sobre el índice y responde
+ * con N Response, una sección por consulta y en el mismo orden. */
+#define BATCH_TAG "__batch"
+#define MAX_BATCH 256
+
+/* Consulta de estado: field_name1 = STATUS_TAG. result = "READY ..." con datos
+ * del índice, o "LOADING" (con RES_LOADING) mientras se construye/carga. */
+#define STATUS_TAG "__status"
+
+/* Métricas: field_name1 = STATS_TAG. result = resumen en texto de los
+ * contadores, la cola y los histogramas de latencia del proceso que atiende
+ * (en pre-fork, el del trabajador que tomó la conexión). */
+#define STATS_TAG "__stats"
+
+/* Caché en frío: field_name1 = EVICT_TAG. El proceso que atiende saca el
+ * índice y el CSV de la caché de páginas (index_map_evict); result =
+ * "EVICTED resident_bytes=..." (lo que quedó en memoria). Para p1-bench -C. */
+#define EVICT_TAG "__evict"
+
+/* Autocompletado: field_name1 = SUGGEST_TAG, value1 = prefijo del título y
+ * value2 = k (en decimal; vacío: SUGGEST_K). result = hasta k títulos que
+ * empiezan con el prefijo, uno por línea y de más a menos versiones; "NA" si
+ * no hay. Sin -A en el daemon, "UNSUPPORTED" con RES_UNSUPPORTED. */
+#define SUGGEST_TAG "__suggest"
+#define SUGGEST_K 10
+
+/* Response.flags */
+#define RES_TRUNCATED 0x1  /* plazo agotado o registro recortado: resultados parciales */
+#define RES_BUSY      0x2  /* cola del daemon llena: reintentar (result = "BUSY") */
+#define RES_LOADING   0x4  /* índice aún cargándose al arrancar (result = "LOADING") */
+#define RES_UNSUPPORTED 0x8 /* REQ_PREFIX/REQ_RANGE sin árbol B+ en el índice,
+                            * REQ_FUZZY/SUGGEST_TAG sin -A o REQ_COUNT sin -U
+                            * (result = "UNSUPPORTED") */
+
 // Respuesta que el daemon devuelve a la UI
 typedef struct {
     // Si no hay resultados, el daemon debe enviar "NA"
     char result[2048];
+    int flags;             // RES_*
+    int queue_us;          // espera en la cola del daemon (microsegundos)
+    int exec_us;           // tiempo de ejecución de la búsqueda (microsegundos)
+    int stage_us[N_STAGES]; // con REQ_TIMING: microsegundos por etapa (STAGE_WRITE
+                            // ocurre después de responder: sólo va a los histogramas)
 } Response;
 
 #endif
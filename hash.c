@@ -1,5 +1,9 @@
+#include <string.h>
+#include <ctype.h>
 #include "hash.h"
 
+#define NORM_MAX 512        /* las claves del índice tienen a lo sumo KEY_SIZE - 1 */
+
 /* Implementación de la función hash djb2 */
 unsigned long hash_string(const char *str) {
     unsigned long hash = 5381;
@@ -9,3 +13,114 @@ unsigned long hash_string(const char *str) {
     return hash;
 }
 
+/* --- wy64 ---
+ * Misma construcción que wyhash (final v4): se leen 16 o 48 bytes por vuelta
+ * y cada par de palabras se mezcla con una multiplicación 64x64→128 cuyo
+ * resultado se pliega con xor. Cada bit de la entrada afecta a todos los de
+ * la salida (avalancha), a diferencia de djb2, cuyos bits bajos (los que usa
+ * % n_buckets) dependen sobre todo de los últimos caracteres. Las lecturas
+ * son memcpy de 8/4 bytes (little-endian en x86). */
+
+static const uint64_t wy_secret[4] = {
+    0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL,
+};
+
+static inline void wy_mum(uint64_t *a, uint64_t *b) {
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t wy_mix(uint64_t a, uint64_t b) {
+    wy_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t wy_r8(const uint8_t *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint64_t wy_r4(const uint8_t *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+/* 1 a 3 bytes: primero, medio y último */
+static inline uint64_t wy_r3(const uint8_t *p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+uint64_t hash_wy64(const void *data, size_t len, uint64_t seed) {
+    const uint8_t *p = data;
+    const uint64_t *s = wy_secret;
+    uint64_t a, b;
+    seed ^= wy_mix(seed ^ s[0], s[1]);
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (wy_r4(p) << 32) | wy_r4(p + ((len >> 3) << 2));
+            b = (wy_r4(p + len - 4) << 32) | wy_r4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = wy_r3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wy_mix(wy_r8(p) ^ s[1], wy_r8(p + 8) ^ seed);
+                see1 = wy_mix(wy_r8(p + 16) ^ s[2], wy_r8(p + 24) ^ see1);
+                see2 = wy_mix(wy_r8(p + 32) ^ s[3], wy_r8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wy_mix(wy_r8(p) ^ s[1], wy_r8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wy_r8(p + i - 16);
+        b = wy_r8(p + i - 8);
+    }
+    a ^= s[1];
+    b ^= seed;
+    wy_mum(&a, &b);
+    return wy_mix(a ^ s[0] ^ len, b ^ s[1]);
+}
+
+/* --- normalización --- */
+
+size_t hash_normalize(const char *key, char *out, size_t out_sz) {
+    if (out_sz == 0) return 0;
+    size_t n = 0;
+    int gap = 0;            /* espacio pendiente entre dos palabras */
+    for (const unsigned char *p = (const unsigned char *)key; *p; ++p) {
+        if (isspace(*p)) { gap = n > 0; continue; }
+        if (n + (size_t)gap + 1 >= out_sz) break;
+        if (gap) { out[n++] = ' '; gap = 0; }
+        out[n++] = (char)tolower(*p);
+    }
+    /* "Título." y "Título" son la misma clave; quitar también el espacio
+     * que deja "Título ." */
+    while (n > 0 && (strchr(".,;:!?", out[n - 1]) || out[n - 1] == ' ')) n--;
+    out[n] = '\0';
+    return n;
+}
+
+/* --- selección por id --- */
+
+static const char *const names[N_HASHES] = { "djb2", "wy64" };
+
+unsigned long hash_key(int hash_id, const char *key) {
+    char norm[NORM_MAX];
+    size_t len = hash_normalize(key, norm, sizeof(norm));
+    if (hash_id == HASH_WY64) return (unsigned long)hash_wy64(norm, len, 0);
+    return hash_string(norm);
+}
+
+const char *hash_name(int hash_id) {
+    return hash_id >= 0 && hash_id < N_HASHES ? names[hash_id] : NULL;
+}
+
+int hash_by_name(const char *name) {
+    for (int i = 0; i < N_HASHES; ++i)
+        if (strcmp(name, names[i]) == 0) return i;
+    return -1;
+}
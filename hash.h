@@ -1,7 +1,40 @@
 #ifndef HASH_H
 #define HASH_H
 
-/* Prototipo de la función hash (solo declaración). */
+#include <stddef.h>
+#include <stdint.h>
+
+/* Funciones hash de las claves del índice. El índice guarda en su header
+ * (IndexHeader.hash_id) cuál usó al construirse, y las búsquedas usan esa.
+ * hash_key hashea la forma normalizada de la clave (hash_normalize), igual
+ * al construir y al buscar: dos títulos que difieren sólo en mayúsculas,
+ * espacios o puntuación final caen en el mismo bucket. */
+enum {
+    HASH_DJB2,      /* djb2: byte a byte, hash * 33 + c (índices anteriores) */
+    HASH_WY64,      /* tipo wyhash: 8 bytes por paso, multiplicación 64x64→128 */
+    N_HASHES
+};
+#define HASH_DEFAULT HASH_WY64
+
+/* djb2 sobre una cadena terminada en '\0'. */
 unsigned long hash_string(const char *str);
 
-#endif 
+/* Hash de 64 bits de len bytes, palabra a palabra (familia wyhash). */
+uint64_t hash_wy64(const void *data, size_t len, uint64_t seed);
+
+/* Forma canónica de key en out (terminada en '\0'; se trunca a out_sz - 1):
+ * minúsculas ASCII, sin espacios al inicio ni al final, cada tramo de
+ * espacios en blanco reducido a un espacio y sin puntuación final
+ * (.,;:!?). Devuelve su longitud. */
+size_t hash_normalize(const char *key, char *out, size_t out_sz);
+
+/* Hash de la clave normalizada con la función hash_id (HASH_*). */
+unsigned long hash_key(int hash_id, const char *key);
+
+/* Nombre de la función ("djb2", "wy64") o NULL si el id no existe. */
+const char *hash_name(int hash_id);
+
+/* Id a partir del nombre, o -1. */
+int hash_by_name(const char *name);
+
+#endif
@@ -6,13 +6,37 @@
 #define N_BUCKETS 1000      /* usamos módulo 1000 */
 #define KEY_SIZE 256        /* títulos largos */
 
+#define INDEX_MAGIC 0x58493150  /* "P1IX" */
+#define INDEX_VERSION 6         /* subir al cambiar el formato en disco */
+
 /* Estructuras que se guardan en disco */
 typedef struct {
+    int magic;                  /* INDEX_MAGIC */
+    int version;                /* INDEX_VERSION */
     int n_buckets;
+    int hash_id;                /* HASH_* de hash.h con que se repartieron las
+                                 * claves (normalizadas, ver hash_normalize) */
+    int index_type;             /* INDEX_TYPE_* */
     long offset_buckets;
     long offset_entries;
+    long n_entries;             /* títulos indexados */
+    /* INDEX_TYPE_BTREE: árbol B+ (btree.h) */
+    long offset_btree;          /* página 0, alineada a btree_page */
+    int btree_page;             /* bytes por nodo */
+    int btree_height;           /* niveles; 1 = la raíz es hoja */
+    long btree_root;            /* página de la raíz */
+    long btree_pages;
 } IndexHeader;
 
+/* IndexHeader.index_type. Las búsquedas por subcadena recorren siempre los
+ * buckets; el árbol B+ se agrega para las consultas ordenadas (por prefijo,
+ * por rango y exactas en orden de título). */
+enum {
+    INDEX_TYPE_HASH,            /* sólo buckets con cadenas de EntryDisk */
+    INDEX_TYPE_BTREE,           /* buckets + árbol B+ sobre los títulos normalizados */
+    N_INDEX_TYPES
+};
+
 typedef struct {
     long first_entry_offset;    /* -1 si el bucket está vacío */
 } BucketDisk;
@@ -23,10 +47,49 @@ typedef struct {
     long next_entry;            /* offset al siguiente EntryDisk */
 } EntryDisk;
 
+/* Índice y CSV proyectados en memoria con mmap (sólo lectura). Los procesos
+ * hijos heredan la misma proyección y comparten las páginas en caché. */
+typedef struct {
+    const char *idx;            /* index.bin completo */
+    size_t idx_size;
+    const char *csv;            /* CSV completo */
+    size_t csv_size;
+    const IndexHeader *header;
+    const BucketDisk *buckets;  /* header->n_buckets posiciones */
+} IndexMap;
+
 /* Prototipos públicos */
 // index.h
-int build_index(const char *csv_path, const char *index_path);
+int build_index(const char *csv_path, const char *index_path, int hash_id, int index_type);
 long search_in_index(const char *key, const char *index_path);
 
+/* Proyecta index_path y csv_path y valida el header. 0; -1 si no se pudo
+ * abrir; INDEX_ERR_FORMAT si el índice es de otra versión, usa una función
+ * hash desconocida o está dañado (hay que reconstruirlo). */
+#define INDEX_ERR_FORMAT (-2)
+int index_map_open(IndexMap *m, const char *index_path, const char *csv_path);
+void index_map_close(IndexMap *m);
+
+/* Precarga las páginas del índice (madvise + lectura de cada página) y, si
+ * lock, las fija en RAM con mlock. 0, o -1 si mlock falló. */
+int index_map_prefault(const IndexMap *m, int lock);
+
+/* Saca de memoria las páginas del índice y del CSV (para medir en frío):
+ * las suelta de esta proyección (madvise) y pide al kernel que las quite de
+ * la caché de páginas (posix_fadvise POSIX_FADV_DONTNEED sobre los archivos).
+ * Es un consejo: las páginas fijadas con mlock o proyectadas por otro proceso
+ * se quedan. En *resident_out deja los bytes que siguen en memoria (mincore).
+ * 0, o -1 si no se pudo abrir algún archivo. */
+int index_map_evict(const IndexMap *m, const char *index_path, const char *csv_path,
+                    size_t *resident_out);
+
+/* Entrada del índice en el offset dado, o NULL si cae fuera del archivo. */
+const EntryDisk *index_map_entry(const IndexMap *m, long offset);
+
+/* Copia en out (terminado en '\0') el registro del CSV que empieza en offset,
+ * incluyendo el '\n' final; los saltos de línea dentro de comillas no lo
+ * cortan. Devuelve la longitud o -1. */
+long index_map_csv_line(const IndexMap *m, long offset, char *out, size_t out_sz);
+
 #endif
 
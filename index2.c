@@ -5,49 +5,47 @@
 #include <strings.h>   /* strcasecmp, strncasecmp */
 #include <ctype.h>
 #include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "index.h"
+#include "btree.h"
 #include "hash.h"
+#include "util.h"
 
 #define RANGE 12  // rango para búsqueda parcial
 
-/* Implementación portable de búsqueda case-insensitive de subcadena.
- * Devuelve puntero a la primera ocurrencia o NULL.
- * Usa strncasecmp para comparar ventanas de tamaño needle_len.
- */
-static char *ci_strcasestr(const char *haystack, const char *needle) {
-    if (!haystack || !needle) return NULL;
-    size_t needle_len = strlen(needle);
-    if (needle_len == 0) return (char *)haystack;
-    for (const char *p = haystack; *p; ++p) {
-        size_t rem = strlen(p);
-        if (rem < needle_len) return NULL;
-        if (strncasecmp(p, needle, needle_len) == 0) return (char *)p;
-    }
-    return NULL;
-}
-
-// --- Función para limpiar texto ---
-void limpiar_texto(char *s) {
-    if (!s) return;
-    size_t len = strlen(s);
-    if (len == 0) return;
-
-    if (s[0] == '"') {
-        memmove(s, s + 1, len);
-        s[len-1] = '\0';
-        len = strlen(s);
-    }
-    if (len > 0 && s[len - 1] == '"') s[len - 1] = '\0';
-
-    len = strlen(s);
-    while (len > 0 && isspace((unsigned char)s[len - 1])) {
-        s[len - 1] = '\0';
-        len--;
+/* Lee un registro CSV completo en *buf (crece con realloc): si un campo entre
+ * comillas contiene saltos de línea, junta las líneas físicas hasta cerrarlo.
+ * Devuelve la longitud del registro, o -1 en EOF/error. */
+static ssize_t read_record(FILE *f, char **buf, size_t *cap) {
+    char *part = NULL;
+    size_t part_cap = 0, len = 0;
+    int in_quotes = 0;
+    ssize_t n;
+    while ((n = getline(&part, &part_cap, f)) > 0) {
+        if (len + (size_t)n + 1 > *cap) {
+            size_t ncap = (len + (size_t)n + 1) * 2;
+            char *nb = realloc(*buf, ncap);
+            if (!nb) { free(part); return -1; }
+            *buf = nb;
+            *cap = ncap;
+        }
+        memcpy(*buf + len, part, (size_t)n);
+        len += (size_t)n;
+        (*buf)[len] = '\0';
+        /* "" dentro de un campo suma dos comillas: la paridad basta */
+        for (ssize_t i = 0; i < n; ++i)
+            if (part[i] == '"') in_quotes = !in_quotes;
+        if (!in_quotes) break;
     }
+    free(part);
+    return len > 0 ? (ssize_t)len : -1;
 }
 
 // --- Función que construye el índice si no existe ---
-int build_index(const char *csv_path, const char *index_path) {
+int build_index(const char *csv_path, const char *index_path, int hash_id, int index_type) {
     FILE *csv = fopen(csv_path, "r");
     if (!csv) { perror("Error abriendo CSV"); return -1; }
 
@@ -55,7 +53,9 @@ int build_index(const char *csv_path, const char *index_path) {
     if (!idx) { perror("Error creando índice"); fclose(csv); return -1; }
 
     // --- Header ---
-    IndexHeader header = { N_BUCKETS, sizeof(IndexHeader), sizeof(IndexHeader) + sizeof(BucketDisk) * N_BUCKETS };
+    IndexHeader header = { INDEX_MAGIC, INDEX_VERSION, N_BUCKETS, hash_id, index_type, sizeof(IndexHeader),
+                           sizeof(IndexHeader) + sizeof(BucketDisk) * N_BUCKETS, 0, 0, 0, 0, 0, 0 };
+    BtreeBuilder tree = { 0 };
     if (fwrite(&header, sizeof(IndexHeader), 1, idx) != 1) {
         perror("Error escribiendo header índice");
         fclose(csv); fclose(idx);
@@ -73,35 +73,28 @@ int build_index(const char *csv_path, const char *index_path) {
     }
 
     // --- Leer CSV ---
-    char line[4096];
+    char *line = NULL;
+    size_t line_cap = 0;
+    char key[KEY_SIZE];
     long line_start;
     /* comprobar retorno al saltar encabezado */
-    if (!fgets(line, sizeof(line), csv)) {
+    if (read_record(csv, &line, &line_cap) < 0) {
         /* archivo vacío o error */
         if (feof(csv)) {
             fprintf(stderr, "CSV vacío o sin encabezado: %s\n", csv_path);
         } else {
             perror("Error leyendo encabezado CSV");
         }
+        free(line);
         fclose(csv); fclose(idx);
         return -1;
     }
 
-    while ( (line_start = ftell(csv)), fgets(line, sizeof(line), csv) ) {
-        /* strtok aquí es simple; si el CSV puede tener comas dentro de campos con comillas
-           deberías usar un parseador robusto. Aquí mantenemos la aproximación original. */
-        char *token = strtok(line, ",\n\r");
-        char *key = NULL;
-        int col = 1;
-        while (token) {
-            if (col == 4) { key = token; break; }
-            token = strtok(NULL, ",\n\r");
-            col++;
-        }
-        if (!key) continue;
-        limpiar_texto(key);
+    while ( (line_start = ftell(csv)), read_record(csv, &line, &line_cap) > 0 ) {
+        /* registro completo: los títulos entre comillas pueden tener comas */
+        if (!csv_get_column(line, 4, key, sizeof(key)) || key[0] == '\0') continue;
 
-        unsigned long h = hash_string(key) % N_BUCKETS;
+        unsigned long h = hash_key(hash_id, key) % N_BUCKETS;
         long bucket_offset = sizeof(IndexHeader) + sizeof(BucketDisk) * h;
 
         BucketDisk b;
@@ -117,7 +110,7 @@ int build_index(const char *csv_path, const char *index_path) {
 
         EntryDisk entry;
         memset(&entry, 0, sizeof(EntryDisk));
-        strncpy(entry.key, key, KEY_SIZE - 1);
+        memcpy(entry.key, key, strnlen(key, KEY_SIZE - 1));
         entry.csv_offset = line_start;
         entry.next_entry = b.first_entry_offset;
 
@@ -140,6 +133,17 @@ int build_index(const char *csv_path, const char *index_path) {
             perror("fwrite bucket (build_index)");
             continue;
         }
+        header.n_entries++;
+
+        char norm[KEY_SIZE];
+        hash_normalize(key, norm, sizeof(norm));
+        if (index_type == INDEX_TYPE_BTREE && btree_add(&tree, norm, line_start) != 0) {
+            fprintf(stderr, "Sin memoria para el árbol B+ (build_index)\n");
+            btree_free(&tree);
+            free(line);
+            fclose(csv); fclose(idx);
+            return -1;
+        }
     }
 
     if (ferror(csv)) {
@@ -147,12 +151,168 @@ int build_index(const char *csv_path, const char *index_path) {
         /* No abortamos necesariamente; ya se escribió lo que se pudo */
     }
 
+    free(line);
+
+    /* árbol B+ detrás de las entradas, ya con todos los títulos */
+    if (index_type == INDEX_TYPE_BTREE) {
+        int rc = btree_write(&tree, idx, &header);
+        btree_free(&tree);
+        if (rc != 0) {
+            perror("Error escribiendo árbol B+");
+            fclose(csv); fclose(idx);
+            return -1;
+        }
+    }
+
+    /* header definitivo con el total de entradas */
+    if (fseek(idx, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(IndexHeader), 1, idx) != 1) {
+        perror("Error reescribiendo header índice");
+        fclose(csv); fclose(idx);
+        return -1;
+    }
+
     fclose(csv);
-    fclose(idx);
-    printf("Índice generado correctamente con %d buckets.\n", N_BUCKETS);
+    if (fclose(idx) != 0) {
+        perror("Error cerrando índice");
+        return -1;
+    }
+    printf("Índice generado correctamente con %d buckets (hash %s).\n", N_BUCKETS, hash_name(hash_id));
+    if (index_type == INDEX_TYPE_BTREE)
+        printf("Árbol B+: %ld páginas de %d bytes, altura %d.\n", header.btree_pages, header.btree_page,
+               header.btree_height);
+    return 0;
+}
+
+// --- Proyección en memoria del índice y del CSV ---
+static const char *map_file(const char *path, size_t *size_out) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { perror(path); return NULL; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        fprintf(stderr, "Archivo vacío o ilegible: %s\n", path);
+        close(fd);
+        return NULL;
+    }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);   /* la proyección sigue válida sin el descriptor */
+    if (p == MAP_FAILED) { perror("mmap"); return NULL; }
+    *size_out = (size_t)st.st_size;
+    return p;
+}
+
+int index_map_open(IndexMap *m, const char *index_path, const char *csv_path) {
+    memset(m, 0, sizeof(*m));
+    m->idx = map_file(index_path, &m->idx_size);
+    if (!m->idx) return -1;
+    m->csv = map_file(csv_path, &m->csv_size);
+    if (!m->csv) { index_map_close(m); return -1; }
+
+    m->header = (const IndexHeader *)m->idx;
+    if (m->idx_size < sizeof(IndexHeader) ||
+        m->header->magic != INDEX_MAGIC || m->header->version != INDEX_VERSION) {
+        fprintf(stderr, "Índice con formato antiguo o desconocido: %s\n", index_path);
+        index_map_close(m);
+        return INDEX_ERR_FORMAT;
+    }
+    if (m->header->n_buckets <= 0 || !hash_name(m->header->hash_id) ||
+        m->header->offset_buckets < (long)sizeof(IndexHeader) ||
+        (size_t)m->header->offset_buckets + sizeof(BucketDisk) * (size_t)m->header->n_buckets > m->idx_size ||
+        m->header->index_type < 0 || m->header->index_type >= N_INDEX_TYPES ||
+        (m->header->index_type == INDEX_TYPE_BTREE &&
+         (m->header->btree_page < (int)sizeof(BtreeNode) || m->header->offset_btree <= 0 ||
+          m->header->offset_btree % m->header->btree_page != 0 || m->header->btree_height < 1 ||
+          m->header->btree_root < 0 || m->header->btree_root >= m->header->btree_pages ||
+          (size_t)m->header->offset_btree + (size_t)m->header->btree_pages * (size_t)m->header->btree_page >
+              m->idx_size))) {
+        fprintf(stderr, "Índice inválido: %s\n", index_path);
+        index_map_close(m);
+        return INDEX_ERR_FORMAT;
+    }
+    m->buckets = (const BucketDisk *)(m->idx + m->header->offset_buckets);
+
+    /* los registros del CSV se leen saltando de offset en offset */
+    madvise((void *)m->csv, m->csv_size, MADV_RANDOM);
+    return 0;
+}
+
+void index_map_close(IndexMap *m) {
+    if (m->idx) munmap((void *)m->idx, m->idx_size);
+    if (m->csv) munmap((void *)m->csv, m->csv_size);
+    memset(m, 0, sizeof(*m));
+}
+
+int index_map_prefault(const IndexMap *m, int lock) {
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0) page = 4096;
+    madvise((void *)m->idx, m->idx_size, MADV_WILLNEED);
+    /* leer un byte por página crea las entradas de la tabla de páginas de
+     * este proceso: la primera consulta no paga fallos de página menores */
+    volatile unsigned char sink = 0;
+    for (size_t off = 0; off < m->idx_size; off += (size_t)page)
+        sink ^= (unsigned char)m->idx[off];
+    (void)sink;
+    if (lock && mlock(m->idx, m->idx_size) != 0) {
+        perror("mlock índice");
+        return -1;
+    }
     return 0;
 }
 
+/* Bytes de [p, p + size) presentes en memoria, según mincore. */
+static size_t resident_bytes(const char *p, size_t size, long page) {
+    size_t n_pages = (size + (size_t)page - 1) / (size_t)page;
+    unsigned char *vec = malloc(n_pages ? n_pages : 1);
+    if (!vec) return 0;
+    size_t resident = 0;
+    if (mincore((void *)p, size, vec) == 0)
+        for (size_t i = 0; i < n_pages; ++i)
+            if (vec[i] & 1) resident += (size_t)page;
+    free(vec);
+    return resident < size ? resident : size;
+}
+
+static int drop_file_cache(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { perror(path); return -1; }
+    int rc = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    return rc == 0 ? 0 : -1;
+}
+
+int index_map_evict(const IndexMap *m, const char *index_path, const char *csv_path,
+                    size_t *resident_out) {
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0) page = 4096;
+    /* primero quitar las páginas de esta proyección: mientras estén en la
+     * tabla de páginas de un proceso, fadvise no las puede desalojar */
+    madvise((void *)m->idx, m->idx_size, MADV_DONTNEED);
+    madvise((void *)m->csv, m->csv_size, MADV_DONTNEED);
+    int rc = 0;
+    if (drop_file_cache(index_path) != 0) rc = -1;
+    if (drop_file_cache(csv_path) != 0) rc = -1;
+    if (resident_out)
+        *resident_out = resident_bytes(m->idx, m->idx_size, page) +
+                        resident_bytes(m->csv, m->csv_size, page);
+    return rc;
+}
+
+const EntryDisk *index_map_entry(const IndexMap *m, long offset) {
+    if (offset < (long)sizeof(IndexHeader) || (size_t)offset + sizeof(EntryDisk) > m->idx_size)
+        return NULL;
+    return (const EntryDisk *)(m->idx + offset);
+}
+
+long index_map_csv_line(const IndexMap *m, long offset, char *out, size_t out_sz) {
+    if (offset < 0 || (size_t)offset >= m->csv_size || out_sz == 0) return -1;
+    size_t avail = m->csv_size - (size_t)offset;
+    if (avail > out_sz - 1) avail = out_sz - 1;
+    const char *start = m->csv + offset;
+    size_t len = csv_record_len(start, avail);
+    memcpy(out, start, len);
+    out[len] = '\0';
+    return (long)len;
+}
+
 // --- Función de búsqueda híbrida ---
 void search_by_keyword(const char *keyword, int exact, const char *index_file) {
     if (!keyword) return;
@@ -161,7 +321,7 @@ void search_by_keyword(const char *keyword, int exact, const char *index_file) {
     FILE *test = fopen(index_file, "rb");
     if (!test) {
         printf("No existe '%s', creando índice...\n", index_file);
-        if (build_index("arxiv.csv", index_file) == -1) return;
+        if (build_index("arxiv.csv", index_file, HASH_DEFAULT, INDEX_TYPE_HASH) == -1) return;
     } else fclose(test);
 
     FILE *idx = fopen(index_file, "rb");
@@ -173,8 +333,18 @@ void search_by_keyword(const char *keyword, int exact, const char *index_file) {
         return;
     }
 
-    clock_t start = clock();
-    unsigned long h = hash_string(keyword) % N_BUCKETS;
+    IndexHeader header;
+    if (fread(&header, sizeof(header), 1, idx) != 1 || header.magic != INDEX_MAGIC ||
+        header.version != INDEX_VERSION || !hash_name(header.hash_id)) {
+        fprintf(stderr, "Índice con formato antiguo o desconocido: %s\n", index_file);
+        fclose(idx); fclose(csv);
+        return;
+    }
+
+    long long start = now_ns();   /* tiempo de reloj, no de CPU (clock()) */
+    unsigned long h = hash_key(header.hash_id, keyword) % N_BUCKETS;
+    char norm_keyword[KEY_SIZE], norm_key[KEY_SIZE];
+    hash_normalize(keyword, norm_keyword, sizeof(norm_keyword));
     int found = 0;
 
     int offset_start = exact ? 0 : -RANGE;
@@ -210,7 +380,9 @@ void search_by_keyword(const char *keyword, int exact, const char *index_file) {
 
             int match = 0;
             if (exact) {
-                if (strcasecmp(entry.key, keyword) == 0) match = 1;
+                /* misma forma normalizada que el hash: basta su bucket */
+                hash_normalize(entry.key, norm_key, sizeof(norm_key));
+                if (strcmp(norm_key, norm_keyword) == 0) match = 1;
             } else {
                 if (ci_strcasestr(entry.key, keyword)) match = 1;
             }
@@ -239,8 +411,8 @@ void search_by_keyword(const char *keyword, int exact, const char *index_file) {
     }
 
 FIN:
-    clock_t end = clock();
-    double segundos = (double)(end - start) / CLOCKS_PER_SEC;
+    long long end = now_ns();
+    double segundos = (double)(end - start) / 1e9;
 
     if (!found)
         printf("No se encontraron resultados con '%s'\n", keyword);
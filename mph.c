@@ -0,0 +1,355 @@
+/* mph.c
+ * Índice exacto con función hash perfecta mínima (ver mph.h), construido
+ * como PTHash:
+ *  - cada título normalizado da un hash de 64 bits h (wy64); los títulos
+ *    repetidos (mismo h) comparten slot y sus offsets van a dups
+ *  - las claves se reparten en n_keys / MPH_LAMBDA buckets por los bits
+ *    altos de h; los buckets se procesan del más grande al más chico y para
+ *    cada uno se busca un piloto (0..65535) tal que pos = mix(h ^ mix(piloto))
+ *    % n_positions deja a todas sus claves en posiciones libres
+ *  - hay n_positions = n_keys / MPH_ALPHA posiciones: la holgura hace que los
+ *    últimos buckets encuentren piloto rápido. Las posiciones >= n_keys que
+ *    quedaron ocupadas se redirigen (remap) a los huecos < n_keys, así los
+ *    slots son exactamente n_keys
+ * Una consulta calcula h, lee un piloto y un slot, y compara la huella.
+ * Memoria: 16 bits por bucket (4 bits por clave) + 4 bytes por posición
+ * redirigida + 16 bytes por slot, frente a sizeof(EntryDisk) por registro.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mph.h"
+#include "hash.h"
+#include "index.h"
+#include "util.h"
+
+#define MPH_LAMBDA 4            /* claves por bucket en promedio */
+#define MPH_ALPHA 0.97          /* ocupación de las posiciones */
+#define MPH_MAX_PILOT 65535
+#define MPH_MAX_SEEDS 32
+#define MAX_RECORD_PREFIX 65536 /* el título va antes del abstract */
+
+/* finalizador de splitmix64 */
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/* Hash del título con semilla: el de la semilla 0 es wy64, así la
+ * construcción guarda un solo hash por registro y reintenta sin releer. */
+static inline uint64_t seeded(uint64_t h0, uint64_t seed) {
+    return seed ? mix64(h0 ^ mix64(seed)) : h0;
+}
+
+static inline uint64_t bucket_of(uint64_t h, uint64_t n_buckets) {
+    return (h >> 32) % n_buckets;
+}
+
+static inline uint64_t position_of(uint64_t h, uint16_t pilot, uint64_t n_positions) {
+    return mix64(h ^ mix64((uint64_t)pilot + 1)) % n_positions;
+}
+
+static uint64_t title_hash(const char *norm) {
+    return hash_wy64(norm, strlen(norm), 0);
+}
+
+/* --- construcción --- */
+
+typedef struct {
+    uint64_t h0;
+    uint64_t offset;
+} Rec;
+
+static int cmp_rec(const void *a, const void *b) {
+    const Rec *x = a, *y = b;
+    if (x->h0 != y->h0) return x->h0 < y->h0 ? -1 : 1;
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+/* (hash, offset) de cada registro con título, ordenados por hash. */
+static Rec *collect_records(const char *csv_path, uint64_t *n_out) {
+    int fd = open(csv_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { perror(csv_path); return NULL; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        fprintf(stderr, "Archivo vacío o ilegible: %s\n", csv_path);
+        close(fd);
+        return NULL;
+    }
+    const char *csv = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (csv == MAP_FAILED) { perror("mmap"); return NULL; }
+    madvise((void *)csv, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    char *rec = malloc(MAX_RECORD_PREFIX);
+    uint64_t cap = 1 << 16, n = 0;
+    Rec *recs = malloc(sizeof(Rec) * cap);
+    const char *p = csv, *end = csv + st.st_size;
+    int header = 1;
+    while (rec && recs && p < end) {
+        size_t len = csv_record_len(p, (size_t)(end - p));
+        if (len == 0) break;
+        size_t copy = len < MAX_RECORD_PREFIX - 1 ? len : MAX_RECORD_PREFIX - 1;
+        memcpy(rec, p, copy);
+        rec[copy] = '\0';
+        uint64_t offset = (uint64_t)(p - csv);
+        p += len;
+        if (header) { header = 0; continue; }
+        /* misma clave que build_index: la columna 4 recortada a KEY_SIZE */
+        char key[KEY_SIZE], norm[KEY_SIZE];
+        if (!csv_get_column(rec, 4, key, sizeof(key)) || key[0] == '\0') continue;
+        hash_normalize(key, norm, sizeof(norm));
+        if (n == cap) {
+            Rec *nr = realloc(recs, sizeof(Rec) * (cap *= 2));
+            if (!nr) { free(recs); recs = NULL; break; }
+            recs = nr;
+        }
+        recs[n].h0 = title_hash(norm);
+        recs[n].offset = offset;
+        n++;
+    }
+    munmap((void *)csv, (size_t)st.st_size);
+    if (!rec || !recs) {
+        /* sin rec el bucle no leyó nada: no escribir un índice vacío */
+        free(rec);
+        free(recs);
+        fprintf(stderr, "Sin memoria (mph)\n");
+        return NULL;
+    }
+    free(rec);
+    qsort(recs, n, sizeof(Rec), cmp_rec);
+    *n_out = n;
+    return recs;
+}
+
+/* Busca los pilotos de las n claves (hashes h0) con la semilla dada. 0 si
+ * todos los buckets encontraron uno, -1 si hay que probar otra semilla. */
+static int find_pilots(const uint64_t *h0, uint64_t n, uint64_t seed, uint64_t n_buckets,
+                       uint64_t n_positions, uint16_t *pilots, uint64_t *pos_of) {
+    int rc = -1;
+    uint64_t *start = calloc(n_buckets + 1, sizeof(uint64_t));
+    uint64_t *members = malloc(sizeof(uint64_t) * (n ? n : 1));
+    uint64_t *order = malloc(sizeof(uint64_t) * n_buckets);
+    unsigned char *taken = calloc(n_positions, 1);
+    if (!start || !members || !order || !taken) goto out;
+
+    /* claves agrupadas por bucket (orden por conteo) */
+    for (uint64_t k = 0; k < n; ++k) start[bucket_of(seeded(h0[k], seed), n_buckets) + 1]++;
+    uint64_t max_size = 0;
+    for (uint64_t b = 0; b < n_buckets; ++b) {
+        if (start[b + 1] > max_size) max_size = start[b + 1];
+        start[b + 1] += start[b];
+    }
+    uint64_t *fill = calloc(n_buckets, sizeof(uint64_t));
+    if (!fill) goto out;
+    for (uint64_t k = 0; k < n; ++k) {
+        uint64_t b = bucket_of(seeded(h0[k], seed), n_buckets);
+        members[start[b] + fill[b]++] = k;
+    }
+    free(fill);
+
+    /* buckets del más grande al más chico */
+    uint64_t *by_size = calloc(max_size + 2, sizeof(uint64_t));
+    if (!by_size) goto out;
+    for (uint64_t b = 0; b < n_buckets; ++b) by_size[max_size - (start[b + 1] - start[b]) + 1]++;
+    for (uint64_t s = 0; s <= max_size; ++s) by_size[s + 1] += by_size[s];
+    for (uint64_t b = 0; b < n_buckets; ++b) order[by_size[max_size - (start[b + 1] - start[b])]++] = b;
+    free(by_size);
+
+    uint64_t pos[64];
+    for (uint64_t i = 0; i < n_buckets; ++i) {
+        uint64_t b = order[i];
+        uint64_t size = start[b + 1] - start[b];
+        if (size == 0) { pilots[b] = 0; continue; }
+        if (size > 64) goto out;     /* con esta semilla el reparto es malo */
+        int found = 0;
+        for (uint32_t pilot = 0; pilot <= MPH_MAX_PILOT && !found; ++pilot) {
+            found = 1;
+            for (uint64_t j = 0; j < size && found; ++j) {
+                uint64_t h = seeded(h0[members[start[b] + j]], seed);
+                pos[j] = position_of(h, (uint16_t)pilot, n_positions);
+                if (taken[pos[j]]) found = 0;
+                for (uint64_t q = 0; q < j && found; ++q)
+                    if (pos[q] == pos[j]) found = 0;
+            }
+            if (found) {
+                pilots[b] = (uint16_t)pilot;
+                for (uint64_t j = 0; j < size; ++j) {
+                    taken[pos[j]] = 1;
+                    pos_of[members[start[b] + j]] = pos[j];
+                }
+            }
+        }
+        if (!found) goto out;
+    }
+    rc = 0;
+out:
+    free(start);
+    free(members);
+    free(order);
+    free(taken);
+    return rc;
+}
+
+int mph_build(const char *csv_path, const char *mph_path) {
+    uint64_t n_records = 0;
+    Rec *recs = collect_records(csv_path, &n_records);
+    if (!recs) return -1;
+
+    /* títulos distintos: first/count sobre recs ordenado por hash */
+    uint64_t n = 0;
+    for (uint64_t i = 0; i < n_records; ++i)
+        if (i == 0 || recs[i].h0 != recs[i - 1].h0) n++;
+    uint64_t *h0 = malloc(sizeof(uint64_t) * (n ? n : 1));
+    uint64_t *first = malloc(sizeof(uint64_t) * (n ? n : 1));
+    uint64_t *pos_of = malloc(sizeof(uint64_t) * (n ? n : 1));
+    uint64_t n_buckets = n / MPH_LAMBDA + 1;
+    uint64_t n_positions = (uint64_t)((double)n / MPH_ALPHA) + 1;
+    uint16_t *pilots = calloc(n_buckets, sizeof(uint16_t));
+    uint32_t *remap = calloc(n_positions - n, sizeof(uint32_t));
+    MphSlot *slots = calloc(n ? n : 1, sizeof(MphSlot));
+    uint64_t *dups = malloc(sizeof(uint64_t) * (n_records ? n_records : 1));
+    int rc = -1;
+    FILE *f = NULL;
+    if (!h0 || !first || !pos_of || !pilots || !remap || !slots || !dups) {
+        fprintf(stderr, "Sin memoria (mph)\n");
+        goto out;
+    }
+    for (uint64_t i = 0, k = 0; i < n_records; ++i)
+        if (i == 0 || recs[i].h0 != recs[i - 1].h0) { h0[k] = recs[i].h0; first[k] = i; k++; }
+
+    uint64_t seed = 0;
+    while (find_pilots(h0, n, seed, n_buckets, n_positions, pilots, pos_of) != 0) {
+        if (++seed >= MPH_MAX_SEEDS) {
+            fprintf(stderr, "mph: no se encontraron pilotos para %s\n", csv_path);
+            goto out;
+        }
+    }
+
+    /* posiciones >= n ocupadas → huecos < n, en orden */
+    unsigned char *used = calloc(n ? n : 1, 1);
+    if (!used) goto out;
+    for (uint64_t k = 0; k < n; ++k) if (pos_of[k] < n) used[pos_of[k]] = 1;
+    uint64_t hole = 0;
+    for (uint64_t k = 0; k < n; ++k) {
+        if (pos_of[k] < n) continue;
+        while (used[hole]) hole++;
+        used[hole] = 1;
+        remap[pos_of[k] - n] = (uint32_t)hole;
+        pos_of[k] = hole;
+    }
+    free(used);
+
+    uint64_t n_dups = 0;
+    for (uint64_t k = 0; k < n; ++k) {
+        uint64_t count = (k + 1 < n ? first[k + 1] : n_records) - first[k];
+        MphSlot *s = &slots[pos_of[k]];
+        s->fingerprint = (uint32_t)seeded(h0[k], seed);
+        s->count = (uint32_t)count;
+        if (count == 1) {
+            s->offset = recs[first[k]].offset;
+        } else {
+            s->offset = n_dups;
+            for (uint64_t j = 0; j < count; ++j) dups[n_dups++] = recs[first[k] + j].offset;
+        }
+    }
+
+    MphHeader hdr = { MPH_MAGIC, MPH_VERSION, seed, n, n_positions, n_buckets, n_records, 0, 0, 0, 0 };
+    /* secciones alineadas a 8 bytes */
+    hdr.offset_pilots = sizeof(MphHeader);
+    hdr.offset_remap = (hdr.offset_pilots + sizeof(uint16_t) * n_buckets + 7) & ~7ULL;
+    hdr.offset_slots = (hdr.offset_remap + sizeof(uint32_t) * (n_positions - n) + 7) & ~7ULL;
+    hdr.offset_dups = hdr.offset_slots + sizeof(MphSlot) * n;
+
+    f = fopen(mph_path, "wb");
+    if (!f) { perror(mph_path); goto out; }
+    static const char zero[8];
+    int ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+             fwrite(pilots, sizeof(uint16_t), n_buckets, f) == n_buckets &&
+             fwrite(zero, 1, hdr.offset_remap - hdr.offset_pilots - sizeof(uint16_t) * n_buckets, f) ==
+                 hdr.offset_remap - hdr.offset_pilots - sizeof(uint16_t) * n_buckets &&
+             fwrite(remap, sizeof(uint32_t), n_positions - n, f) == n_positions - n &&
+             fwrite(zero, 1, hdr.offset_slots - hdr.offset_remap - sizeof(uint32_t) * (n_positions - n), f) ==
+                 hdr.offset_slots - hdr.offset_remap - sizeof(uint32_t) * (n_positions - n) &&
+             fwrite(slots, sizeof(MphSlot), n, f) == n &&
+             fwrite(dups, sizeof(uint64_t), n_dups, f) == n_dups;
+    if (fclose(f) != 0 || !ok) {
+        perror("Error escribiendo índice exacto");
+        goto out;
+    }
+    f = NULL;
+    printf("Índice exacto generado: %llu títulos distintos (%llu registros), %.1f bits/clave de pilotos y remap, %.1f MB\n",
+           (unsigned long long)n, (unsigned long long)n_records,
+           n ? (double)(16 * n_buckets + 32 * (n_positions - n)) / (double)n : 0.0,
+           (double)(hdr.offset_dups + sizeof(uint64_t) * n_dups) / 1e6);
+    rc = 0;
+out:
+    if (f) fclose(f);
+    free(recs); free(h0); free(first); free(pos_of);
+    free(pilots); free(remap); free(slots); free(dups);
+    return rc;
+}
+
+/* --- consulta --- */
+
+int mph_open(MphMap *m, const char *mph_path) {
+    memset(m, 0, sizeof(*m));
+    int fd = open(mph_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MphHeader)) { close(fd); return INDEX_ERR_FORMAT; }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) { perror("mmap"); return -1; }
+    m->base = p;
+    m->size = (size_t)st.st_size;
+    m->header = (const MphHeader *)m->base;
+
+    const MphHeader *h = m->header;
+    if (h->magic != MPH_MAGIC || h->version != MPH_VERSION || h->n_buckets == 0 ||
+        h->n_positions < h->n_keys || h->offset_pilots + sizeof(uint16_t) * h->n_buckets > h->offset_remap ||
+        h->offset_remap + sizeof(uint32_t) * (h->n_positions - h->n_keys) > h->offset_slots ||
+        h->offset_slots + sizeof(MphSlot) * h->n_keys > h->offset_dups || h->offset_dups > m->size) {
+        fprintf(stderr, "Índice exacto con formato antiguo o dañado: %s\n", mph_path);
+        mph_close(m);
+        return INDEX_ERR_FORMAT;
+    }
+    m->pilots = (const uint16_t *)(m->base + h->offset_pilots);
+    m->remap = (const uint32_t *)(m->base + h->offset_remap);
+    m->slots = (const MphSlot *)(m->base + h->offset_slots);
+    m->dups = (const uint64_t *)(m->base + h->offset_dups);
+    return 0;
+}
+
+void mph_close(MphMap *m) {
+    if (m->base) munmap((void *)m->base, m->size);
+    memset(m, 0, sizeof(*m));
+}
+
+long mph_lookup(const MphMap *m, const char *norm, const uint64_t **offsets, uint64_t *single) {
+    const MphHeader *hdr = m->header;
+    if (!hdr || hdr->n_keys == 0) return 0;
+    uint64_t h = seeded(title_hash(norm), hdr->seed);
+    uint64_t pos = position_of(h, m->pilots[bucket_of(h, hdr->n_buckets)], hdr->n_positions);
+    if (pos >= hdr->n_keys) pos = m->remap[pos - hdr->n_keys];
+    if (pos >= hdr->n_keys) return 0;
+    const MphSlot *s = &m->slots[pos];
+    if (s->fingerprint != (uint32_t)h || s->count == 0) return 0;
+    if (s->count == 1) {
+        *single = s->offset;
+        *offsets = single;
+        return 1;
+    }
+    size_t n_dups = (m->size - hdr->offset_dups) / sizeof(uint64_t);
+    if (s->offset + s->count > n_dups) return 0;
+    *offsets = m->dups + s->offset;
+    return (long)s->count;
+}
@@ -0,0 +1,61 @@
+#ifndef MPH_H
+#define MPH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Índice estático para búsquedas exactas (opcional, -x): función hash
+ * perfecta mínima estilo PTHash sobre los títulos normalizados
+ * (hash_normalize). Cada título distinto tiene exactamente un slot con su
+ * huella y el offset de su registro en el CSV; se consulta con una sola
+ * sonda, sin cadenas. Como el CSV se reemplaza entero y no se modifica,
+ * el índice se reconstruye junto con index.bin. */
+
+#define MPH_FILE "index.mph"
+#define MPH_MAGIC 0x48504d50    /* "PMPH" */
+#define MPH_VERSION 1
+
+typedef struct {
+    uint32_t magic;             /* MPH_MAGIC */
+    uint32_t version;           /* MPH_VERSION */
+    uint64_t seed;              /* semilla con la que se encontraron los pilotos */
+    uint64_t n_keys;            /* títulos distintos = slots */
+    uint64_t n_positions;       /* n_keys / MPH_ALPHA: rango de las posiciones */
+    uint64_t n_buckets;         /* un piloto por bucket */
+    uint64_t n_records;         /* registros indexados (con títulos repetidos) */
+    uint64_t offset_pilots;     /* uint16_t[n_buckets] */
+    uint64_t offset_remap;      /* uint32_t[n_positions - n_keys]: posiciones >= n_keys */
+    uint64_t offset_slots;      /* MphSlot[n_keys] */
+    uint64_t offset_dups;       /* uint64_t[]: offsets de los títulos repetidos */
+} MphHeader;
+
+typedef struct {
+    uint32_t fingerprint;       /* 32 bits bajos del hash del título */
+    uint32_t count;             /* registros con ese título */
+    uint64_t offset;            /* count == 1: offset en el CSV; si no, índice en dups */
+} MphSlot;
+
+typedef struct {
+    const char *base;           /* archivo proyectado (sólo lectura) */
+    size_t size;
+    const MphHeader *header;
+    const uint16_t *pilots;
+    const uint32_t *remap;
+    const MphSlot *slots;
+    const uint64_t *dups;
+} MphMap;
+
+/* Construye mph_path desde el CSV. 0, o -1. */
+int mph_build(const char *csv_path, const char *mph_path);
+
+/* Proyecta y valida mph_path. 0; -1 si no se pudo abrir; INDEX_ERR_FORMAT
+ * (index.h) si es de otra versión o está dañado. */
+int mph_open(MphMap *m, const char *mph_path);
+void mph_close(MphMap *m);
+
+/* Registros cuyo título normalizado podría ser norm (la huella coincide;
+ * hay que confirmarlo leyendo el registro). Deja en *offsets los n offsets
+ * del CSV (single guarda el único si es uno) y devuelve n, 0 si no está. */
+long mph_lookup(const MphMap *m, const char *norm, const uint64_t **offsets, uint64_t *single);
+
+#endif
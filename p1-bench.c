@@ -0,0 +1,500 @@
+/* p1-bench.c
+ *
+ * Banco de pruebas: reproduce un archivo de consultas contra p1-search y
+ * reporta throughput y percentiles de latencia en JSON (stdout).
+ *
+ * Archivo de consultas: una por línea, "title" o "title<TAB>YYYY-MM-DD";
+ * las líneas vacías y las que empiezan con '#' se ignoran. Se recorre en
+ * orden, en bucle, hasta completar -n peticiones.
+ *
+ * Uso:
+ *  ./p1-bench -f consultas.txt [-m socket|fifo] [-s socket] [-c clientes]
+ *             [-n peticiones] [-w calentamiento] [-T ms] [-S] [-E | -p | -z | -K] [-C [-r vueltas]]
+ *    -m     transporte: socket UNIX (por defecto) o el protocolo FIFO de la
+ *           UI (una petición a la vez: fuerza -c 1)
+ *    -c N   clientes concurrentes (hilos, una conexión cada uno)
+ *    -n N   peticiones medidas (por defecto, una vuelta al archivo)
+ *    -w N   peticiones de calentamiento, no medidas (por defecto 0)
+ *    -T ms  timeout_ms de cada Request (0: el del daemon)
+ *    -S     pedir REQ_TIMING y reportar el tiempo medio por etapa
+ *    -E     búsquedas exactas (REQ_EXACT) en lugar de por subcadena
+ *    -p     búsquedas por prefijo (REQ_PREFIX; el daemon necesita -b). Las
+ *           respuestas UNSUPPORTED cuentan como errores
+ *    -z     búsquedas aproximadas (REQ_FUZZY, distancia FUZZY_K; el daemon
+ *           necesita -A)
+ *    -K     sólo contar los títulos que contienen cada consulta (REQ_COUNT;
+ *           el daemon necesita -U)
+ *    -C     modo frío: en cada vuelta pide al daemon (EVICT_TAG) que saque
+ *           index.bin y arxiv.csv de la caché de páginas, mide n peticiones
+ *           en frío y luego las mismas n en caliente; reporta ambas por
+ *           separado con los fallos de página mayores y los bytes leídos
+ *           del disco por el daemon (línea "io" de STATS_TAG)
+ *    -r N   vueltas del modo frío (por defecto 3)
+ * server_mean_us separa la latencia media en espera en cola y ejecución (según
+ * el daemon) e ipc (el resto: transporte, copias, planificación).
+ * Antes de medir espera a que el daemon responda READY a "__status".
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "common.h"
+
+#define MAX_QUERY_LINE 1024
+#define READY_WAIT_SEC 600
+
+typedef struct {
+    char title[256];
+    char date[64];
+} BenchQuery;
+
+typedef struct {
+    int use_fifo;
+    const char *sock_path;
+    int timeout_ms;
+    int req_flags;
+    BenchQuery *queries;
+    long n_queries;
+} BenchConfig;
+
+typedef struct {
+    const BenchConfig *cfg;
+    long first, count;       /* peticiones [first, first + count) del total */
+    int measure;
+    long long *lat_ns;       /* count latencias (si measure); -1 si no se atendió */
+    long ok, errors, busy, truncated, empty;   /* ok: atendidas (ni error ni BUSY) */
+    long long stage_us[N_STAGES];   /* suma de Response.stage_us (con -S) */
+    long long queue_us, exec_us;    /* suma de Response.queue_us / exec_us */
+} ClientArg;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static ssize_t io_full(int fd, void *buf, size_t n, int writing) {
+    size_t done = 0;
+    while (done < n) {
+        ssize_t r = writing ? write(fd, (const char *)buf + done, n - done)
+                            : read(fd, (char *)buf + done, n - done);
+        if (r < 0) { if (errno == EINTR) continue; return -1; }
+        if (r == 0) break;
+        done += (size_t)r;
+    }
+    return (ssize_t)done;
+}
+
+/* --- transportes --- */
+
+static int sock_connect(const char *path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) { close(fd); return -1; }
+    return fd;
+}
+
+/* Una ida y vuelta; *fd es la conexión del cliente (se reabre si hace falta). */
+static int roundtrip(const BenchConfig *cfg, int *fd, const Request *req, Response *res) {
+    if (cfg->use_fifo) {
+        int fdw = open(FIFO_REQ, O_WRONLY);
+        if (fdw < 0) return -1;
+        ssize_t w = io_full(fdw, (void *)req, sizeof(*req), 1);
+        close(fdw);
+        if (w != (ssize_t)sizeof(*req)) return -1;
+        /* si el daemon aún no cerró el FIFO_RES de la respuesta anterior, el
+         * open se empareja con ese escritor y la lectura da EOF sin datos:
+         * se vuelve a abrir para esperar la respuesta de verdad */
+        for (int tries = 0; tries < 100; ++tries) {
+            int fdr = open(FIFO_RES, O_RDONLY);
+            if (fdr < 0) return -1;
+            ssize_t r = io_full(fdr, res, sizeof(*res), 0);
+            close(fdr);
+            if (r != 0) return r == (ssize_t)sizeof(*res) ? 0 : -1;
+        }
+        return -1;
+    }
+    if (*fd < 0 && (*fd = sock_connect(cfg->sock_path)) < 0) return -1;
+    if (io_full(*fd, (void *)req, sizeof(*req), 1) != (ssize_t)sizeof(*req) ||
+        io_full(*fd, res, sizeof(*res), 0) != (ssize_t)sizeof(*res)) {
+        close(*fd);
+        *fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+static void make_request(const BenchConfig *cfg, const BenchQuery *q, Request *req) {
+    memset(req, 0, sizeof(*req));
+    snprintf(req->field_name1, sizeof(req->field_name1), "title");
+    snprintf(req->value1, sizeof(req->value1), "%s", q->title);
+    if (q->date[0]) {
+        snprintf(req->field_name2, sizeof(req->field_name2), "update_date");
+        snprintf(req->value2, sizeof(req->value2), "%s", q->date);
+    }
+    req->timeout_ms = cfg->timeout_ms;
+    req->flags = cfg->req_flags;
+}
+
+static void *client_main(void *p) {
+    ClientArg *a = p;
+    const BenchConfig *cfg = a->cfg;
+    int fd = -1;
+    Request req;
+    Response res;
+    for (long i = 0; i < a->count; ++i) {
+        make_request(cfg, &cfg->queries[(a->first + i) % cfg->n_queries], &req);
+        long long t0 = now_ns();
+        int rc = roundtrip(cfg, &fd, &req, &res);
+        long long t1 = now_ns();
+        if (!a->measure) continue;
+        /* los errores y los rechazos BUSY no cuentan en latencias ni en
+         * throughput: bajo sobrecarga serían respuestas instantáneas */
+        a->lat_ns[i] = -1;
+        if (rc != 0 || (res.flags & RES_UNSUPPORTED)) { a->errors++; continue; }
+        if (res.flags & RES_BUSY) { a->busy++; continue; }
+        a->lat_ns[i] = t1 - t0;
+        a->ok++;
+        if (res.flags & RES_TRUNCATED) a->truncated++;
+        if (strncmp(res.result, "NA", 3) == 0) a->empty++;
+        for (int s = 0; s < N_STAGES; ++s) a->stage_us[s] += res.stage_us[s];
+        a->queue_us += res.queue_us;
+        a->exec_us += res.exec_us;
+    }
+    if (fd >= 0) close(fd);
+    return NULL;
+}
+
+/* --- entrada / salida --- */
+
+/* Copia truncando a sz-1 bytes. */
+static void copy_field(char *dst, size_t sz, const char *src) {
+    size_t len = strnlen(src, sz - 1);
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static BenchQuery *load_queries(const char *path, long *n_out) {
+    FILE *f = fopen(path, "r");
+    if (!f) { perror(path); return NULL; }
+    long cap = 1024, n = 0;
+    BenchQuery *qs = malloc(sizeof(BenchQuery) * (size_t)cap);
+    char line[MAX_QUERY_LINE];
+    while (qs && fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+        if (n == cap) {
+            BenchQuery *nq = realloc(qs, sizeof(BenchQuery) * (size_t)(cap *= 2));
+            if (!nq) { free(qs); qs = NULL; break; }
+            qs = nq;
+        }
+        char *tab = strchr(line, '\t');
+        if (tab) *tab = '\0';
+        copy_field(qs[n].title, sizeof(qs[n].title), line);
+        copy_field(qs[n].date, sizeof(qs[n].date), tab ? tab + 1 : "");
+        n++;
+    }
+    fclose(f);
+    if (qs && n == 0) { fprintf(stderr, "%s: sin consultas\n", path); free(qs); return NULL; }
+    *n_out = n;
+    return qs;
+}
+
+static int wait_ready(const BenchConfig *cfg) {
+    Request req;
+    Response res;
+    memset(&req, 0, sizeof(req));
+    snprintf(req.field_name1, sizeof(req.field_name1), "%s", STATUS_TAG);
+    long long limit = now_ns() + (long long)READY_WAIT_SEC * 1000000000LL;
+    while (now_ns() < limit) {
+        int fd = -1;
+        int rc = roundtrip(cfg, &fd, &req, &res);
+        if (fd >= 0) close(fd);
+        if (rc == 0 && strncmp(res.result, "READY", 5) == 0) return 0;
+        usleep(200000);
+    }
+    fprintf(stderr, "El daemon no quedó listo en %d s\n", READY_WAIT_SEC);
+    return -1;
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+/* Percentil por rango más cercano sobre lat (ordenado), en microsegundos. */
+static double pct_us(const long long *lat, long n, double p) {
+    if (n == 0) return 0.0;
+    long k = (long)(p / 100.0 * (double)n + 0.999999) - 1;
+    if (k < 0) k = 0;
+    if (k >= n) k = n - 1;
+    return (double)lat[k] / 1000.0;
+}
+
+/* Lanza `conc` clientes que reparten n peticiones a partir de *next. */
+static int run_phase(const BenchConfig *cfg, int conc, long n, long *next, int measure,
+                     ClientArg *args, long long *lat) {
+    pthread_t *th = calloc((size_t)conc, sizeof(pthread_t));
+    if (!th) return -1;
+    long assigned = 0;
+    for (int i = 0; i < conc; ++i) {
+        memset(&args[i], 0, sizeof(ClientArg));
+        args[i].cfg = cfg;
+        args[i].count = n / conc + (i < n % conc ? 1 : 0);
+        args[i].first = *next + assigned;
+        args[i].measure = measure;
+        args[i].lat_ns = lat ? lat + assigned : NULL;
+        assigned += args[i].count;
+    }
+    *next += n;
+    int started = 0;
+    for (int i = 0; i < conc; ++i, ++started)
+        if (pthread_create(&th[i], NULL, client_main, &args[i]) != 0) break;
+    for (int i = 0; i < started; ++i) pthread_join(th[i], NULL);
+    free(th);
+    return started == conc ? 0 : -1;
+}
+
+/* --- modo en frío (-C) --- */
+
+/* Contadores de E/S del proceso del daemon, de la línea "io" de STATS_TAG. */
+typedef struct {
+    long long major_faults;
+    long long read_bytes;
+} DaemonIo;
+
+/* Resultado de una o varias fases medidas. */
+typedef struct {
+    long ok, errors, busy, truncated, empty;
+    long long stage_us[N_STAGES];
+    long long queue_us, exec_us;
+    double secs;
+    long long major_faults, read_bytes;   /* sólo en modo frío */
+} Totals;
+
+/* Una petición de control (STATS_TAG, EVICT_TAG) por una conexión propia. */
+static int control(const BenchConfig *cfg, const char *tag, Response *res) {
+    Request req;
+    memset(&req, 0, sizeof(req));
+    snprintf(req.field_name1, sizeof(req.field_name1), "%s", tag);
+    int fd = -1;
+    int rc = roundtrip(cfg, &fd, &req, res);
+    if (fd >= 0) close(fd);
+    if (rc != 0) fprintf(stderr, "Sin respuesta a %s\n", tag);
+    return rc;
+}
+
+static int daemon_io(const BenchConfig *cfg, DaemonIo *io) {
+    Response res;
+    if (control(cfg, STATS_TAG, &res) != 0) return -1;
+    const char *p = strstr(res.result, "major_faults=");
+    const char *q = strstr(res.result, "disk_read_bytes=");
+    if (!p || !q || sscanf(p, "major_faults=%lld", &io->major_faults) != 1 ||
+        sscanf(q, "disk_read_bytes=%lld", &io->read_bytes) != 1) {
+        fprintf(stderr, "El daemon no informa E/S en %s\n", STATS_TAG);
+        return -1;
+    }
+    return 0;
+}
+
+/* Pide al daemon que saque el índice y el CSV de la caché de páginas. */
+static int evict_cache(const BenchConfig *cfg, long long *resident) {
+    Response res;
+    if (control(cfg, EVICT_TAG, &res) != 0) return -1;
+    const char *p = strstr(res.result, "resident_bytes=");
+    if (strncmp(res.result, "EVICTED", 7) != 0 || !p || sscanf(p, "resident_bytes=%lld", resident) != 1) {
+        fprintf(stderr, "No se pudo desalojar la caché: %s", res.result);
+        return -1;
+    }
+    return 0;
+}
+
+/* --- resultados --- */
+
+static void add_totals(Totals *t, const ClientArg *args, int conc) {
+    for (int i = 0; i < conc; ++i) {
+        t->queue_us += args[i].queue_us; t->exec_us += args[i].exec_us;
+        t->ok += args[i].ok; t->errors += args[i].errors; t->busy += args[i].busy;
+        t->truncated += args[i].truncated; t->empty += args[i].empty;
+        for (int s = 0; s < N_STAGES; ++s) t->stage_us[s] += args[i].stage_us[s];
+    }
+}
+
+static void print_header(const BenchConfig *cfg, const char *query_file, int conc, long n) {
+    printf("{\n");
+    printf("  \"transport\": \"%s\",\n", cfg->use_fifo ? "fifo" : "socket");
+    printf("  \"query_file\": \"%s\",\n", query_file);
+    printf("  \"concurrency\": %d,\n", conc);
+    printf("  \"requests\": %ld,\n", n);
+}
+
+/* Conteos, throughput y latencias (n en lat; se descartan las -1 de las
+ * peticiones no atendidas y se ordena) con sangría ind; sin salto de línea
+ * final. */
+static void print_totals(const char *ind, const Totals *t, long long *lat, long n, int timing) {
+    long m = 0;
+    for (long i = 0; i < n; ++i)
+        if (lat[i] >= 0) lat[m++] = lat[i];
+    n = m;
+    qsort(lat, (size_t)n, sizeof(long long), cmp_ll);
+    double sum = 0;
+    for (long i = 0; i < n; ++i) sum += (double)lat[i];
+    double mean_us = n ? sum / (double)n / 1000.0 : 0.0;
+
+    printf("%s\"ok\": %ld,\n%s\"errors\": %ld,\n%s\"busy\": %ld,\n%s\"truncated\": %ld,\n%s\"no_results\": %ld,\n",
+           ind, t->ok, ind, t->errors, ind, t->busy, ind, t->truncated, ind, t->empty);
+    printf("%s\"duration_s\": %.6f,\n", ind, t->secs);
+    printf("%s\"throughput_rps\": %.2f,\n", ind, t->secs > 0 ? (double)n / t->secs : 0.0);
+    printf("%s\"latency_us\": { \"min\": %.1f, \"mean\": %.1f, \"p50\": %.1f, \"p90\": %.1f, "
+           "\"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f }", ind,
+           n ? (double)lat[0] / 1000.0 : 0.0, mean_us, pct_us(lat, n, 50), pct_us(lat, n, 90),
+           pct_us(lat, n, 99), pct_us(lat, n, 99.9), n ? (double)lat[n - 1] / 1000.0 : 0.0);
+    /* lo que el daemon informa en cada Response; el resto de la latencia es
+     * transporte (socket/FIFO, copia de la respuesta, planificación) */
+    double q_mean = t->ok ? (double)t->queue_us / (double)t->ok : 0.0;
+    double e_mean = t->ok ? (double)t->exec_us / (double)t->ok : 0.0;
+    double ipc_mean = mean_us - q_mean - e_mean;
+    printf(",\n%s\"server_mean_us\": { \"queue\": %.1f, \"exec\": %.1f, \"ipc\": %.1f }",
+           ind, q_mean, e_mean, ipc_mean > 0 ? ipc_mean : 0.0);
+    if (timing) {
+        /* STAGE_WRITE no viaja en la respuesta (ver common.h) */
+        static const char *names[STAGE_WRITE] = { "parse", "open", "walk", "match", "fetch", "filter" };
+        printf(",\n%s\"stage_mean_us\": {", ind);
+        for (int s = 0; s < STAGE_WRITE; ++s)
+            printf("%s \"%s\": %.1f", s ? "," : "", names[s], t->ok ? (double)t->stage_us[s] / (double)t->ok : 0.0);
+        printf(" }");
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Uso: %s -f consultas.txt [-m socket|fifo] [-s socket] [-c clientes] "
+                    "[-n peticiones] [-w calentamiento] [-T ms] [-S] [-E | -p | -z | -K] [-C [-r vueltas]]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    BenchConfig cfg = { .use_fifo = 0, .sock_path = SOCK_PATH };
+    const char *query_file = NULL;
+    int conc = 1;
+    long n = -1, warm = 0;
+    int cold = 0;
+    long runs = 3, errors = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:m:s:c:n:w:T:SCr:EpzK")) != -1) {
+        switch (opt) {
+        case 'f': query_file = optarg; break;
+        case 'm':
+            if (strcmp(optarg, "fifo") == 0) cfg.use_fifo = 1;
+            else if (strcmp(optarg, "socket") == 0) cfg.use_fifo = 0;
+            else { usage(argv[0]); return 1; }
+            break;
+        case 's': cfg.sock_path = optarg; break;
+        case 'c': conc = atoi(optarg); break;
+        case 'n': n = atol(optarg); break;
+        case 'w': warm = atol(optarg); break;
+        case 'T': cfg.timeout_ms = atoi(optarg); break;
+        case 'S': cfg.req_flags |= REQ_TIMING; break;
+        case 'E': cfg.req_flags |= REQ_EXACT; break;
+        case 'p': cfg.req_flags |= REQ_PREFIX; break;
+        case 'z': cfg.req_flags |= REQ_FUZZY; break;
+        case 'K': cfg.req_flags |= REQ_COUNT; break;
+        case 'C': cold = 1; break;
+        case 'r': runs = atol(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (!query_file || conc < 1 || warm < 0 || runs < 1) { usage(argv[0]); return 1; }
+    if (cold && warm > 0) {
+        fprintf(stderr, "Modo frío: se ignora -w (la fase caliente es la propia medición)\n");
+        warm = 0;
+    }
+    if (cfg.use_fifo && conc > 1) {
+        fprintf(stderr, "Modo fifo: una petición a la vez, se usa -c 1\n");
+        conc = 1;
+    }
+
+    cfg.queries = load_queries(query_file, &cfg.n_queries);
+    if (!cfg.queries) return 1;
+    if (n <= 0) n = cfg.n_queries;
+    if (conc > n) conc = (int)n;
+
+    if (wait_ready(&cfg) != 0) return 1;
+
+    ClientArg *args = calloc((size_t)conc, sizeof(ClientArg));
+    long long *lat = calloc((size_t)n, sizeof(long long));
+    if (!args || !lat) { fprintf(stderr, "Sin memoria\n"); return 1; }
+
+    long next = 0;
+    if (!cold) {
+        if (warm > 0 && run_phase(&cfg, conc, warm, &next, 0, args, NULL) != 0) return 1;
+        Totals tot = { 0 };
+        long long t0 = now_ns();
+        if (run_phase(&cfg, conc, n, &next, 1, args, lat) != 0) return 1;
+        tot.secs = (double)(now_ns() - t0) / 1e9;
+        add_totals(&tot, args, conc);
+
+        print_header(&cfg, query_file, conc, n);
+        print_totals("  ", &tot, lat, n, cfg.req_flags & REQ_TIMING);
+        printf("\n}\n");
+        errors = tot.errors;
+    } else {
+        /* cada vuelta: desalojar, n peticiones en frío, y las mismas n otra vez
+         * ya en caché; las latencias de todas las vueltas se juntan */
+        long total = n * runs;
+        long long *warm_lat = calloc((size_t)total, sizeof(long long));
+        long long *cold_lat = realloc(lat, sizeof(long long) * (size_t)total);
+        if (!warm_lat || !cold_lat) { fprintf(stderr, "Sin memoria\n"); return 1; }
+        lat = cold_lat;
+        Totals tot[2] = { { 0 }, { 0 } };   /* 0: frío, 1: caliente */
+        long long resident = 0;
+        for (long r = 0; r < runs; ++r) {
+            DaemonIo io[3];
+            long long res_bytes;
+            if (evict_cache(&cfg, &res_bytes) != 0 || daemon_io(&cfg, &io[0]) != 0) return 1;
+            resident += res_bytes;
+            for (int phase = 0; phase < 2; ++phase) {
+                long first = r * n;
+                long long t0 = now_ns();
+                if (run_phase(&cfg, conc, n, &first, 1, args, (phase ? warm_lat : cold_lat) + r * n) != 0) return 1;
+                tot[phase].secs += (double)(now_ns() - t0) / 1e9;
+                add_totals(&tot[phase], args, conc);
+                if (daemon_io(&cfg, &io[phase + 1]) != 0) return 1;
+                tot[phase].major_faults += io[phase + 1].major_faults - io[phase].major_faults;
+                tot[phase].read_bytes += io[phase + 1].read_bytes - io[phase].read_bytes;
+            }
+        }
+
+        print_header(&cfg, query_file, conc, n);
+        printf("  \"mode\": \"cold\",\n  \"runs\": %ld,\n", runs);
+        printf("  \"resident_bytes_after_evict\": %lld,\n", resident / runs);
+        for (int phase = 0; phase < 2; ++phase) {
+            printf("  \"%s\": {\n", phase ? "warm" : "cold");
+            print_totals("    ", &tot[phase], phase ? warm_lat : cold_lat, total, cfg.req_flags & REQ_TIMING);
+            printf(",\n    \"major_faults\": %lld,\n    \"disk_read_bytes\": %lld\n  }%s\n",
+                   tot[phase].major_faults, tot[phase].read_bytes, phase ? "" : ",");
+            errors += tot[phase].errors;
+        }
+        printf("}\n");
+        free(warm_lat);
+    }
+
+    free(args);
+    free(lat);
+    free(cfg.queries);
+    return errors == 0 ? 0 : 2;
+}
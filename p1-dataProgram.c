@@ -1,6 +1,7 @@
 /* ui.c
  * UI que se comunica con un daemon vía FIFOs (IPC). Usa structs Request/Response definidos en common.h.
- * Menú: (1) title  (2) date (YYYY-MM-DD)  (3) buscar  (4) salir
+ * Menú: (1) title  (2) date (YYYY-MM-DD)  (3) buscar  (4) salir  (5) autocompletar title
+ * Si una búsqueda por title da "NA", se reintenta aproximada (REQ_FUZZY) por si hubo errores de tipeo.
  * NOTA: la UI NO hace la búsqueda; sólo valida entradas, arma la Request, mide tiempo y muestra la Response.
  */
 
@@ -50,6 +51,7 @@ static void print_menu(const char *title_value, const char *date_value) {
     }
     printf("3. Realizar búsqueda\n");                                   // Dispara el envío al daemon.
     printf("4. Salir\n");                                               // Termina el programa.
+    printf("5. Autocompletar título\n");                               // Sugerencias del daemon (-A).
     printf("=================================================\n");       // Separador estético.
     printf("Elija una opción: ");                                       // Prompt de lectura de opción.
     fflush(stdout);                                                     // Garantiza que el prompt se imprima ya.
@@ -152,6 +154,78 @@ static int send_request_and_get_response(const Request *req, Response *res) {
     return 0;                                           // Éxito total de ida y vuelta.
 }
 
+/* -------------------------------------------------------------------------- */
+/* autocomplete_title:
+ * - Pide un prefijo y muestra numeradas las sugerencias del daemon (SUGGEST_TAG).
+ * - Un número elige esa sugerencia como title; otro texto es un prefijo nuevo
+ *   (se puede ir refinando); una línea vacía vuelve al menú sin cambios.
+ * Devuelve 1 si se eligió un título (copiado en title_buf), 0 si no.
+ */
+static int autocomplete_title(char *title_buf, size_t title_sz) {
+    char lines[SUGGEST_K][256];                         // Sugerencias de la última respuesta.
+    int n_lines = 0;                                    // Cuántas hay en lines.
+    printf("Escriba el comienzo del título (Enter vacío para volver): ");
+    fflush(stdout);                                     // Imprime prompt.
+
+    while (1) {                                         // Hasta elegir o volver.
+        char input[MAX_INPUT];                          // Prefijo o número elegido.
+        if (!fgets(input, sizeof(input), stdin)) {      // EOF/error: vuelve al menú.
+            printf("\nEntrada interrumpida. Volviendo al menú.\n");
+            return 0;
+        }
+        input[strcspn(input, "\r\n")] = '\0';          // Elimina \r/\n finales.
+        // Sin trim: un espacio final indica que la última palabra ya está completa.
+        if (input[0] == '\0') return 0;                 // Vacío: volver sin cambios.
+
+        char *end;                                      // Fin del número, si lo es.
+        long pick = strtol(input, &end, 10);            // ¿Eligió una sugerencia?
+        if (n_lines > 0 && *end == '\0' && pick >= 1 && pick <= n_lines) {
+            strncpy(title_buf, lines[pick-1], title_sz-1); // Copia segura de la elegida.
+            title_buf[title_sz-1] = '\0';               // Garantiza terminación.
+            return 1;
+        }
+
+        Request req;                                    // Pedido de sugerencias.
+        Response res;                                   // Respuesta del daemon.
+        memset(&req, 0, sizeof(req));
+        memset(&res, 0, sizeof(res));
+        snprintf(req.field_name1, sizeof(req.field_name1), "%s", SUGGEST_TAG); // Pedido de control.
+        snprintf(req.value1, sizeof(req.value1), "%.*s", (int)sizeof(req.value1)-1, input); // Prefijo tal cual.
+        snprintf(req.value2, sizeof(req.value2), "%d", SUGGEST_K);             // Cuántas sugerencias.
+
+        if (send_request_and_get_response(&req, &res) != 0) { // IPC: FIFO_REQ -> FIFO_RES.
+            printf("Error comunicándose con el buscador. Asegúrate de que el daemon está corriendo.\n");
+            return 0;
+        }
+        if (res.flags & RES_UNSUPPORTED) {              // Daemon sin -A.
+            printf("El buscador no tiene autocompletado (inícielo con -A).\n");
+            return 0;
+        }
+        if (res.flags & RES_LOADING) {                  // Índice aún cargándose.
+            printf("El buscador está preparando el índice. Intenta de nuevo en unos momentos.\n");
+            return 0;
+        }
+
+        n_lines = 0;                                    // Reparte result en líneas.
+        res.result[sizeof(res.result)-1] = '\0';        // Acota el texto al buffer.
+        if (strcmp(res.result, "NA") != 0) {
+            for (char *p = res.result; *p && n_lines < SUGGEST_K; ) {
+                size_t len = strcspn(p, "\n");          // Largo de esta línea.
+                snprintf(lines[n_lines], sizeof(lines[n_lines]), "%.*s", (int)len, p);
+                n_lines++;
+                p += len + (p[len] == '\n');            // Salta el '\n' si lo hay.
+            }
+        }
+        if (n_lines == 0) {
+            printf("Sin sugerencias. Escriba otro comienzo (Enter vacío para volver): ");
+        } else {
+            for (int i = 0; i < n_lines; ++i) printf("  %d. %s\n", i + 1, lines[i]);
+            printf("Número para elegir, otro comienzo para refinar (Enter vacío para volver): ");
+        }
+        fflush(stdout);                                 // Imprime prompt.
+    }
+}
+
 /* -------------------------------------------------------------------------- */
 /* main: loop de menú y orquestación de la UI */
 int main(void) {
@@ -170,7 +244,7 @@ int main(void) {
         trim_inplace(opt_line);                        // Limpia espacios y saltos finales.
         if (opt_line[0] == '\0') continue;             // Línea vacía: reimprime menú.
 
-        int opt = atoi(opt_line);                      // Convierte a entero (basta para 1..4).
+        int opt = atoi(opt_line);                      // Convierte a entero (basta para 1..5).
 
         if (opt == 1) {                                // Opción 1: Capturar “title”.
             printf("Ingrese primer criterio de búsqueda (title): ");
@@ -249,7 +323,18 @@ int main(void) {
                 continue;                              // Vuelve al menú.
             }
 
+            if (res.flags & RES_LOADING) {             // El daemon aún construye/carga el índice.
+                printf("El buscador está preparando el índice. Intenta de nuevo en unos momentos.\n");
+                continue;                              // Vuelve al menú.
+            }
+            if (res.flags & RES_BUSY) {                // Cola del daemon llena: no se buscó.
+                printf("El buscador está ocupado en este momento. Intenta de nuevo.\n");
+                continue;                              // Vuelve al menú.
+            }
+
             printf(">> Tiempo que tardó la búsqueda: %.3f segundos\n", elapsed); // Muestra latencia.
+            if (res.flags & RES_TRUNCATED)             // Plazo agotado o registro recortado.
+                printf(">> Aviso: resultados parciales (plazo agotado o registro demasiado largo).\n");
             printf(">> Resultado de la búsqueda:\n");  // Encabezado de resultados.
 
             // Nota: asumimos que Response tiene un campo 'result' (char[]). La UI imprime “tal cual”.
@@ -266,13 +351,31 @@ int main(void) {
                 }
             }
 
+            // Sin resultados con title: quizá un error de tipeo; reintenta aproximada (REQ_FUZZY).
+            if (title_buf[0] != '\0' && strncmp(res.result, "NA", 3) == 0) {
+                req.flags = REQ_FUZZY;                 // Misma Request, títulos a distancia <= FUZZY_K.
+                memset(&res, 0, sizeof(res));          // Limpia la Response anterior.
+                if (send_request_and_get_response(&req, &res) == 0 &&
+                    !(res.flags & (RES_UNSUPPORTED | RES_LOADING | RES_BUSY)) && // Daemon sin -A, etc.: nada que sugerir.
+                    strncmp(res.result, "NA", 3) != 0) {
+                    printf(">> Títulos parecidos (hasta %d errores de tipeo):\n", FUZZY_K);
+                    size_t len = strnlen(res.result, sizeof(res.result)); // Longitud acotada al buffer.
+                    fwrite(res.result, 1, len, stdout); // Imprime tal cual.
+                    if (len > 0 && res.result[len-1] != '\n') putchar('\n'); // Salto de línea final.
+                }
+            }
+
             continue;                                  // Tras mostrar, vuelve al menú.
 
         } else if (opt == 4) {                         // Opción 4: Salir.
             printf("Saliendo...\n");                   // Mensaje de despedida.
             break;                                     // Corta el while(1).
 
-        } else {                                       // Opción fuera de 1..4.
+        } else if (opt == 5) {                         // Opción 5: Elegir title entre sugerencias.
+            autocomplete_title(title_buf, sizeof(title_buf)); // Si elige, title_buf queda actualizado.
+            continue;                                  // Vuelve al menú (muestra title actualizado).
+
+        } else {                                       // Opción fuera de 1..5.
             printf("Opción no válida. Intenta de nuevo.\n");
             continue;                                  // Repite menú.
         }
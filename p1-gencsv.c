@@ -0,0 +1,397 @@
+/* p1-gencsv.c
+ *
+ * Generador determinista de un CSV con el esquema de arxiv.csv (14 columnas)
+ * para medir sin descargar el dump real. La misma semilla y el mismo número
+ * de filas producen siempre el mismo archivo, byte a byte (PRNG propio, sin
+ * rand()). Entre máquinas depende además de la libm: la CDF de la Zipf usa
+ * pow() y el número de autores log(), que pueden redondear distinto.
+ *
+ * Lo que imita del dump:
+ *  - títulos de 3 a 25 palabras con vocabulario de frecuencia tipo Zipf
+ *    (pocas palabras muy repetidas y una cola larga de palabras raras);
+ *  - campos entre comillas con comas, comillas escapadas ("") y saltos de
+ *    línea (los abstracts y algunos comments vienen cortados en líneas);
+ *  - abstracts largos (80 a 350 palabras);
+ *  - update_date repartida entre 2007 y 2024, con más peso en años recientes.
+ *
+ * Uso:
+ *  ./p1-gencsv [-n filas] [-s semilla] [-o arxiv.csv] [-q consultas.txt] [-Q n]
+ *    -q escribe además un archivo de consultas para p1-bench tomadas del
+ *       propio CSV (títulos completos, fragmentos y títulos con fecha);
+ *       -Q fija cuántas (por defecto 1000). El CSV no cambia por usar -q.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <math.h>
+#include <unistd.h>
+
+#define VOCAB_SIZE 6000
+#define ZIPF_S 1.07
+#define MAX_TITLE_WORDS 25
+#define FIELD_SIZE 4096
+#define FIRST_YEAR 2007
+#define LAST_YEAR 2024
+
+/* --- PRNG (splitmix64) --- */
+
+static uint64_t rng_next(uint64_t *st) {
+    uint64_t z = (*st += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Entero uniforme en [lo, hi]. */
+static int rng_range(uint64_t *st, int lo, int hi) {
+    return lo + (int)(rng_next(st) % (uint64_t)(hi - lo + 1));
+}
+
+/* Real uniforme en [0, 1). */
+static double rng_unit(uint64_t *st) {
+    return (double)(rng_next(st) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* --- vocabulario --- */
+
+/* Palabras frecuentes en títulos de arXiv: ocupan los primeros rangos de la
+ * Zipf. El resto del vocabulario son pseudopalabras formadas por sílabas. */
+static const char *common_words[] = {
+    "of", "the", "and", "in", "for", "a", "on", "with", "to", "quantum",
+    "theory", "model", "field", "systems", "dynamics", "analysis", "from", "by", "via", "spin",
+    "states", "magnetic", "energy", "dark", "matter", "galaxy", "black", "hole", "gauge", "neural",
+    "networks", "learning", "graphs", "random", "stochastic", "equations", "nonlinear", "optical", "phase", "transition",
+    "scattering", "symmetry", "entanglement", "topological", "superconductivity", "cosmological", "constraints", "observations", "evidence", "properties",
+    "effects", "structure", "formation", "evolution", "stars", "star", "galaxies", "clusters", "interactions", "algorithms",
+    "approach", "method", "new", "study", "high", "low", "temperature", "density", "lattice", "boundary",
+    "conditions", "solutions", "space", "time", "spectral", "gravitational", "waves", "emission", "neutrino", "mass",
+    "electron", "photon", "quark", "hadron", "collisions", "decay", "measurement", "detection", "search", "limits",
+    "inequalities", "operators", "algebras", "manifolds", "groups", "representations", "invariants", "geometry", "curvature", "estimates",
+};
+#define N_COMMON (int)(sizeof(common_words) / sizeof(common_words[0]))
+
+static const char *syllables[] = {
+    "ka", "lo", "mi", "ter", "an", "pho", "gra", "ne", "tri", "do", "sil", "qua", "ron", "ex",
+    "vel", "ti", "ma", "sor", "pli", "cen", "dy", "mo", "ra", "zon", "ic", "ul", "per", "fi",
+};
+#define N_SYLL (int)(sizeof(syllables) / sizeof(syllables[0]))
+
+static const char *last_names[] = {
+    "Smith", "Garcia", "Wang", "Müller", "Rossi", "Kim", "Ivanov", "Dubois", "Tanaka", "Silva",
+    "Nguyen", "Cohen", "O'Brien", "Kowalski", "Haddad", "Novak", "Jensen", "Lopez", "Chen", "Singh",
+};
+#define N_LAST (int)(sizeof(last_names) / sizeof(last_names[0]))
+
+static const char *categories[] = {
+    "hep-th", "hep-ph", "astro-ph", "gr-qc", "quant-ph", "cond-mat.str-el", "cond-mat.mes-hall",
+    "math.AG", "math.PR", "math.CO", "cs.LG", "cs.DS", "cs.CV", "stat.ML", "physics.optics", "nucl-th",
+};
+#define N_CAT (int)(sizeof(categories) / sizeof(categories[0]))
+
+static const char *journals[] = { "Phys. Rev. D", "Phys. Rev. Lett.", "Astrophys. J.", "JHEP", "Nucl. Phys. B" };
+#define N_JOURNAL (int)(sizeof(journals) / sizeof(journals[0]))
+
+static const char *licenses[] = {
+    "http://arxiv.org/licenses/nonexclusive-distrib/1.0/",
+    "http://creativecommons.org/licenses/by/4.0/",
+    "http://creativecommons.org/licenses/by-nc-sa/3.0/",
+};
+#define N_LICENSE (int)(sizeof(licenses) / sizeof(licenses[0]))
+
+static const char *weekdays[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+static const char *months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+static char *vocab[VOCAB_SIZE];
+static double zipf_cdf[VOCAB_SIZE];
+
+static int build_vocab(void) {
+    uint64_t st = 0x5EED;   /* el vocabulario no depende de la semilla */
+    for (int i = 0; i < VOCAB_SIZE; ++i) {
+        char w[32] = "";
+        if (i < N_COMMON) snprintf(w, sizeof(w), "%s", common_words[i]);
+        else
+            for (int k = rng_range(&st, 2, 4); k > 0; --k)
+                strcat(w, syllables[rng_range(&st, 0, N_SYLL - 1)]);
+        if (!(vocab[i] = strdup(w))) return -1;
+    }
+    double sum = 0, acc = 0;
+    for (int i = 0; i < VOCAB_SIZE; ++i) sum += 1.0 / pow(i + 1, ZIPF_S);
+    for (int i = 0; i < VOCAB_SIZE; ++i) {
+        acc += 1.0 / pow(i + 1, ZIPF_S) / sum;
+        zipf_cdf[i] = acc;
+    }
+    zipf_cdf[VOCAB_SIZE - 1] = 1.0;
+    return 0;
+}
+
+/* Palabra del vocabulario según la Zipf (búsqueda binaria en la CDF). */
+static const char *zipf_word(uint64_t *st) {
+    double u = rng_unit(st);
+    int lo = 0, hi = VOCAB_SIZE - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (zipf_cdf[mid] < u) lo = mid + 1; else hi = mid;
+    }
+    return vocab[lo];
+}
+
+/* --- campos --- */
+
+typedef struct {
+    char s[FIELD_SIZE];
+    size_t len;
+} Field;
+
+static void field_add(Field *f, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void field_add(Field *f, const char *fmt, ...) {
+    if (f->len >= sizeof(f->s) - 1) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(f->s + f->len, sizeof(f->s) - f->len, fmt, ap);
+    va_end(ap);
+    if (n > 0) f->len += (size_t)n;
+    if (f->len > sizeof(f->s) - 1) f->len = sizeof(f->s) - 1;
+}
+
+/* Campo entre comillas, duplicando las comillas internas. */
+static void put_quoted(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; ++s) {
+        if (*s == '"') fputc('"', out);
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+static void gen_person(uint64_t *st, Field *f, int full_first) {
+    char initial = (char)('A' + rng_range(st, 0, 25));
+    if (full_first)
+        field_add(f, "%c%s%s %s", initial, syllables[rng_range(st, 0, N_SYLL - 1)],
+                  syllables[rng_range(st, 0, N_SYLL - 1)], last_names[rng_range(st, 0, N_LAST - 1)]);
+    else field_add(f, "%c. %s", initial, last_names[rng_range(st, 0, N_LAST - 1)]);
+}
+
+static void gen_title(uint64_t *st, Field *f) {
+    int n = 3 + rng_range(st, 0, 5) + rng_range(st, 0, 5) + rng_range(st, 0, 4);
+    if (rng_unit(st) < 0.03) n = rng_range(st, 15, MAX_TITLE_WORDS);
+    int colon = n > 6 && rng_unit(st) < 0.10 ? rng_range(st, 2, n - 3) : -1;
+    int comma = n > 5 && rng_unit(st) < 0.12 ? rng_range(st, 1, n - 2) : -1;
+    int quoted = rng_unit(st) < 0.02 ? rng_range(st, 0, n - 1) : -1;
+    for (int i = 0; i < n; ++i) {
+        const char *w = zipf_word(st);
+        if (i > 0) field_add(f, " ");
+        if (i == quoted) field_add(f, "\"");
+        if (i == 0 || i == colon + 1) field_add(f, "%c%s", toupper((unsigned char)w[0]), w + 1);
+        else field_add(f, "%s", w);
+        if (i == quoted) field_add(f, "\"");
+        if (i == colon) field_add(f, ":");
+        else if (i == comma) field_add(f, ",");
+    }
+}
+
+/* Abstract con frases y comas, cortado en líneas de ~75 columnas. */
+static void gen_abstract(uint64_t *st, Field *f) {
+    int words = 80 + rng_range(st, 0, 135) + rng_range(st, 0, 135);
+    size_t col = 2;
+    field_add(f, "  ");
+    int sentence_left = 0;
+    for (int i = 0; i < words; ++i) {
+        const char *w = zipf_word(st);
+        int capital = sentence_left == 0;
+        if (capital) sentence_left = rng_range(st, 8, 25);
+        if (col + strlen(w) + 1 > 75) { field_add(f, "\n"); col = 0; }
+        else if (i > 0) { field_add(f, " "); col++; }
+        if (capital)
+            field_add(f, "%c%s", toupper((unsigned char)w[0]), w + 1);
+        else field_add(f, "%s", w);
+        col += strlen(w);
+        if (--sentence_left == 0 || i == words - 1) { field_add(f, "."); col++; }
+        else if (rng_unit(st) < 0.06) { field_add(f, ","); col++; }
+    }
+    field_add(f, "\n");
+}
+
+static int days_in_month(int y, int m) {
+    static const int d[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return d[m - 1] + (m == 2 && ((y % 4 == 0 && y % 100 != 0) || y % 400 == 0));
+}
+
+/* Día de la semana (0 = domingo), método de Sakamoto. */
+static int weekday(int y, int m, int d) {
+    static const int t[] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+    if (m < 3) y--;
+    return (y + y / 4 - y / 100 + y / 400 + t[m - 1] + d) % 7;
+}
+
+/* Año con peso creciente hacia los recientes (como el volumen de arXiv). */
+static int gen_year(uint64_t *st) {
+    int span = LAST_YEAR - FIRST_YEAR + 1;
+    int total = span * (span + 1) / 2;
+    int r = rng_range(st, 1, total);
+    for (int k = 1; k <= span; ++k) {
+        if (r <= k) return FIRST_YEAR + k - 1;
+        r -= k;
+    }
+    return LAST_YEAR;
+}
+
+typedef struct {
+    char title[FIELD_SIZE];
+    char date[32];
+} RowInfo;
+
+static void gen_row(uint64_t *st, long row, FILE *out, RowInfo *info) {
+    Field f;
+
+    /* id: yymm.nnnnn, único hasta 111.6M filas (93 años de 12 meses) */
+    long month_idx = row / 100000;
+    fprintf(out, "\"%02ld%02ld.%05ld\",", 7 + month_idx / 12 % 93, 1 + month_idx % 12, row % 100000);
+
+    f.len = 0; f.s[0] = '\0';
+    gen_person(st, &f, 1);
+    put_quoted(out, f.s); fputc(',', out);
+
+    f.len = 0; f.s[0] = '\0';
+    int n_auth = 1 + (int)(-log(1.0 - rng_unit(st)) * 2.0);
+    if (n_auth > 12) n_auth = 12;
+    for (int i = 0; i < n_auth; ++i) {
+        if (i > 0) field_add(&f, i == n_auth - 1 ? " and " : ", ");
+        gen_person(st, &f, 0);
+    }
+    put_quoted(out, f.s); fputc(',', out);
+
+    f.len = 0; f.s[0] = '\0';
+    gen_title(st, &f);
+    put_quoted(out, f.s); fputc(',', out);
+    memcpy(info->title, f.s, f.len + 1);
+
+    f.len = 0; f.s[0] = '\0';
+    gen_abstract(st, &f);
+    put_quoted(out, f.s); fputc(',', out);
+
+    f.len = 0; f.s[0] = '\0';
+    for (int i = rng_range(st, 1, 3); i > 0; --i)
+        field_add(&f, "%s%s", f.len ? " " : "", categories[rng_range(st, 0, N_CAT - 1)]);
+    put_quoted(out, f.s); fputc(',', out);
+
+    f.len = 0; f.s[0] = '\0';
+    if (rng_unit(st) < 0.6) {
+        field_add(&f, "%d pages, %d figures", rng_range(st, 4, 60), rng_range(st, 0, 15));
+        if (rng_unit(st) < 0.15) field_add(&f, "\nSubmitted to %s", journals[rng_range(st, 0, N_JOURNAL - 1)]);
+    }
+    put_quoted(out, f.s); fputc(',', out);
+
+    int year = gen_year(st);
+    int month = rng_range(st, 1, 12);
+    int day = rng_range(st, 1, days_in_month(year, month));
+
+    f.len = 0; f.s[0] = '\0';
+    int has_journal = rng_unit(st) < 0.3;
+    if (has_journal)
+        field_add(&f, "%s %d, %d (%d)", journals[rng_range(st, 0, N_JOURNAL - 1)],
+                  rng_range(st, 1, 120), rng_range(st, 1, 9999), year);
+    put_quoted(out, f.s); fputc(',', out);
+
+    f.len = 0; f.s[0] = '\0';
+    if (has_journal) field_add(&f, "10.1103/PhysRevD.%d.%06d", rng_range(st, 1, 110), rng_range(st, 0, 999999));
+    put_quoted(out, f.s); fputc(',', out);
+
+    f.len = 0; f.s[0] = '\0';
+    if (rng_unit(st) < 0.05) field_add(&f, "IFT-UAM/CSIC-%02d-%03d", year % 100, rng_range(st, 1, 200));
+    put_quoted(out, f.s); fputc(',', out);
+
+    put_quoted(out, rng_unit(st) < 0.7 ? "" : licenses[rng_range(st, 0, N_LICENSE - 1)]);
+    fputc(',', out);
+
+    snprintf(info->date, sizeof(info->date), "%04d-%02d-%02d", year, month, day);
+    fprintf(out, "%s,", info->date);
+
+    int versions = 1;
+    while (versions < 9 && rng_unit(st) < 0.35) versions++;
+    fprintf(out, "%d,", versions);
+
+    /* última versión: el mismo día o antes que update_date */
+    int vd = rng_range(st, 1, day);
+    fprintf(out, "\"%s, %d %s %d %02d:%02d:%02d GMT\"\n", weekdays[weekday(year, month, vd)], vd,
+            months[month - 1], year, rng_range(st, 0, 23), rng_range(st, 0, 59), rng_range(st, 0, 59));
+}
+
+/* Consulta para p1-bench a partir de la fila: título completo, fragmento de
+ * 1 a 3 palabras, o título con su fecha. */
+static void write_query(uint64_t *st, FILE *q, const RowInfo *info) {
+    double u = rng_unit(st);
+    if (u < 0.4) { fprintf(q, "%s\n", info->title); return; }
+    if (u < 0.6) { fprintf(q, "%s\t%s\n", info->title, info->date); return; }
+
+    const char *words[MAX_TITLE_WORDS + 1];
+    int lens[MAX_TITLE_WORDS + 1];
+    int n = 0;
+    for (const char *p = info->title; *p && n <= MAX_TITLE_WORDS; ) {
+        while (*p == ' ') p++;
+        if (!*p) break;
+        words[n] = p;
+        while (*p && *p != ' ') p++;
+        lens[n] = (int)(p - words[n]);
+        n++;
+    }
+    int k = rng_range(st, 1, 3);
+    if (k > n) k = n;
+    int start = rng_range(st, 0, n - k);
+    /* una palabra vacía ("of", "the") coincidiría con casi todo */
+    if (k == 1 && lens[start] < 4 && n > 1) { k = 2; if (start > n - k) start = n - k; }
+    int len = (int)(words[start + k - 1] + lens[start + k - 1] - words[start]);
+    fprintf(q, "%.*s\n", len, words[start]);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Uso: %s [-n filas] [-s semilla] [-o arxiv.csv] [-q consultas.txt] [-Q n]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    long rows = 10000, n_queries = 1000;
+    unsigned long long seed = 1;
+    const char *out_path = "arxiv.csv", *query_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:o:q:Q:")) != -1) {
+        switch (opt) {
+        case 'n': rows = atol(optarg); break;
+        case 's': seed = strtoull(optarg, NULL, 10); break;
+        case 'o': out_path = optarg; break;
+        case 'q': query_path = optarg; break;
+        case 'Q': n_queries = atol(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (rows < 1 || n_queries < 1) { usage(argv[0]); return 1; }
+    if (build_vocab() != 0) { fprintf(stderr, "Sin memoria\n"); return 1; }
+
+    FILE *out = fopen(out_path, "w");
+    if (!out) { perror(out_path); return 1; }
+    setvbuf(out, NULL, _IOFBF, 1 << 20);
+    FILE *q = NULL;
+    if (query_path && !(q = fopen(query_path, "w"))) { perror(query_path); fclose(out); return 1; }
+
+    fputs("id,submitter,authors,title,abstract,categories,comments,journal-ref,doi,"
+          "report-no,license,update_date,versions_count,versions_last_created\n", out);
+
+    /* flujos independientes: el CSV no depende de si se piden consultas */
+    uint64_t st = seed, qst = seed ^ 0xC0FFEEULL;
+    long every = rows / n_queries > 0 ? rows / n_queries : 1;
+    static RowInfo info;
+    for (long r = 0; r < rows; ++r) {
+        gen_row(&st, r, out, &info);
+        if (q && r % every == 0 && r / every < n_queries) write_query(&qst, q, &info);
+    }
+
+    int rc = 0;
+    if (fclose(out) != 0) { perror(out_path); rc = 1; }
+    if (q && fclose(q) != 0) { perror(query_path); rc = 1; }
+    for (int i = 0; i < VOCAB_SIZE; ++i) free(vocab[i]);
+    return rc;
+}
@@ -0,0 +1,188 @@
+/* p1-hashstat.c
+ *
+ * Análisis de distribución de las funciones hash del índice sobre un CSV:
+ * reparte los títulos (columna 4) en -b buckets con cada función (o sólo con
+ * -k) igual que build_index, y reporta por función:
+ *  - chi2 del balance de buckets frente a un reparto uniforme, con sus
+ *    grados de libertad (buckets - 1) y z = (chi2 - gl) / sqrt(2 gl): con
+ *    un hash uniforme |z| queda por debajo de ~3
+ *  - buckets vacíos y percentiles del largo de cadena (p50, p90, p99, max)
+ *  - visited: largo medio de la cadena que recorre la búsqueda de una clave
+ *    del índice (suma de largo² / títulos; 1 + títulos/buckets si es uniforme)
+ *  - ns por título al calcular el hash, en total y sólo en los títulos de
+ *    más de 64 bytes (mediana de -r vueltas)
+ *
+ * Uso:
+ *  ./p1-hashstat [-c arxiv.csv] [-b buckets] [-k hash] [-r vueltas]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "index.h"
+#include "hash.h"
+#include "util.h"
+
+#define LONG_TITLE 64
+#define MAX_RECORD_PREFIX 65536   /* el título va antes del abstract */
+
+static volatile unsigned long sink;
+
+typedef struct {
+    char **titles;
+    long n;
+} Titles;
+
+/* Títulos no vacíos del CSV, recorriendo registros completos como el índice. */
+static int load_titles(const char *path, Titles *t) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { perror(path); return -1; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) { fprintf(stderr, "CSV vacío: %s\n", path); close(fd); return -1; }
+    const char *csv = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (csv == MAP_FAILED) { perror("mmap"); return -1; }
+    madvise((void *)csv, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    char *rec = malloc(MAX_RECORD_PREFIX);
+    long cap = 1 << 16;
+    t->titles = malloc(sizeof(char *) * (size_t)cap);
+    t->n = 0;
+    if (!rec || !t->titles) { fprintf(stderr, "Sin memoria\n"); return -1; }
+
+    const char *p = csv, *end = csv + st.st_size;
+    int header = 1;
+    while (p < end) {
+        size_t len = csv_record_len(p, (size_t)(end - p));
+        if (len == 0) break;
+        size_t copy = len < MAX_RECORD_PREFIX - 1 ? len : MAX_RECORD_PREFIX - 1;
+        memcpy(rec, p, copy);
+        rec[copy] = '\0';
+        p += len;
+        if (header) { header = 0; continue; }
+        char key[KEY_SIZE];
+        if (!csv_get_column(rec, 4, key, sizeof(key)) || key[0] == '\0') continue;
+        if (t->n == cap) {
+            char **nt = realloc(t->titles, sizeof(char *) * (size_t)(cap *= 2));
+            if (!nt) { fprintf(stderr, "Sin memoria\n"); return -1; }
+            t->titles = nt;
+        }
+        if (!(t->titles[t->n++] = strdup(key))) { fprintf(stderr, "Sin memoria\n"); return -1; }
+    }
+    free(rec);
+    munmap((void *)csv, (size_t)st.st_size);
+    return 0;
+}
+
+static int cmp_long(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* ns por título de la función id sobre los títulos (de más de LONG_TITLE
+ * bytes si only_long), mediana de runs vueltas; -1 si no hay ninguno. */
+static double time_hash(int id, const Titles *t, int only_long, int runs) {
+    double *v = malloc(sizeof(double) * (size_t)runs);
+    if (!v) return -1;
+    long count = 0;
+    for (int r = 0; r < runs + 1; ++r) {     /* la vuelta 0 calienta */
+        struct timespec a, b;
+        unsigned long acc = 0;
+        count = 0;
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        for (long i = 0; i < t->n; ++i) {
+            if (only_long && strlen(t->titles[i]) <= LONG_TITLE) continue;
+            acc += hash_key(id, t->titles[i]);
+            count++;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        sink += acc;
+        if (r > 0 && count > 0)
+            v[r - 1] = ((double)(b.tv_sec - a.tv_sec) * 1e9 + (double)(b.tv_nsec - a.tv_nsec)) / (double)count;
+    }
+    double med = -1;
+    if (count > 0) {
+        qsort(v, (size_t)runs, sizeof(double), cmp_double);
+        med = v[runs / 2];
+    }
+    free(v);
+    return med;
+}
+
+static void report(int id, const Titles *t, long n_buckets, int runs) {
+    long *chain = calloc((size_t)n_buckets, sizeof(long));
+    if (!chain) { fprintf(stderr, "Sin memoria\n"); return; }
+    for (long i = 0; i < t->n; ++i)
+        chain[hash_key(id, t->titles[i]) % (unsigned long)n_buckets]++;
+
+    double expected = (double)t->n / (double)n_buckets;
+    double chi2 = 0, sq = 0;
+    long empty = 0;
+    for (long b = 0; b < n_buckets; ++b) {
+        double d = (double)chain[b] - expected;
+        chi2 += d * d / expected;
+        sq += (double)chain[b] * (double)chain[b];
+        if (chain[b] == 0) empty++;
+    }
+    double dof = (double)(n_buckets - 1);
+    qsort(chain, (size_t)n_buckets, sizeof(long), cmp_long);
+    #define PCT(p) chain[(long)((p) / 100.0 * (double)(n_buckets - 1))]
+
+    printf("%-6s %12.1f %8.0f %8.2f %7ld %6ld %6ld %6ld %6ld %9.1f %8.1f %10.1f\n",
+           hash_name(id), chi2, dof, (chi2 - dof) / sqrt(2 * dof), empty,
+           PCT(50), PCT(90), PCT(99), chain[n_buckets - 1], sq / (double)t->n,
+           time_hash(id, t, 0, runs), time_hash(id, t, 1, runs));
+    #undef PCT
+    free(chain);
+}
+
+int main(int argc, char **argv) {
+    const char *csv_path = "arxiv.csv";
+    long n_buckets = N_BUCKETS;
+    int only = -1, runs = 11;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:b:k:r:")) != -1) {
+        switch (opt) {
+        case 'c': csv_path = optarg; break;
+        case 'b': n_buckets = atol(optarg); break;
+        case 'k': only = hash_by_name(optarg); if (only < 0) goto usage; break;
+        case 'r': runs = atoi(optarg); break;
+        default: goto usage;
+        }
+    }
+    if (n_buckets < 2 || runs < 1) goto usage;
+
+    Titles t;
+    if (load_titles(csv_path, &t) != 0) return 1;
+    if (t.n == 0) { fprintf(stderr, "%s: sin títulos\n", csv_path); return 1; }
+    long n_long = 0;
+    for (long i = 0; i < t.n; ++i) n_long += strlen(t.titles[i]) > LONG_TITLE;
+
+    printf("%s: %ld títulos (%ld de más de %d bytes), %ld buckets, %.2f por bucket\n",
+           csv_path, t.n, n_long, LONG_TITLE, n_buckets, (double)t.n / (double)n_buckets);
+    printf("%-6s %12s %8s %8s %7s %6s %6s %6s %6s %9s %8s %10s\n", "hash", "chi2", "gl", "z",
+           "empty", "p50", "p90", "p99", "max", "visited", "ns", "ns_largos");
+    for (int id = 0; id < N_HASHES; ++id)
+        if (only < 0 || id == only) report(id, &t, n_buckets, runs);
+
+    for (long i = 0; i < t.n; ++i) free(t.titles[i]);
+    free(t.titles);
+    return 0;
+
+usage:
+    fprintf(stderr, "Uso: %s [-c arxiv.csv] [-b buckets] [-k djb2|wy64] [-r vueltas]\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,367 @@
+/* p1-microbench.c
+ *
+ * Microbenchmarks de los núcleos que corren en cada consulta y en cada
+ * construcción del índice: hash_string (djb2), hash_wy64, ci_strcasestr,
+ * csv_get_column, trim_inplace, field_is, el recorrido de cadenas de buckets
+ * y la búsqueda exacta de un título en index.bin y en index.swt (swiss.c).
+ *
+ * Cada núcleo se ejecuta sobre datos reales (registros de arxiv.csv y, para
+ * el recorrido de cadenas, index.bin): primero unas vueltas de calentamiento
+ * que no se miden, luego -r vueltas cronometradas. De cada vuelta sale el
+ * costo por operación en ns (CLOCK_MONOTONIC) y en ciclos (rdtsc en x86; en
+ * otras arquitecturas esa columna queda en 0). Se reporta mediana y MAD
+ * (desviación absoluta mediana), que no se mueven por una vuelta ruidosa.
+ *
+ * Uso:
+ *  ./p1-microbench [-c arxiv.csv] [-i index.bin] [-x index.swt] [-n registros] [-r vueltas] [-k kernel]
+ *    -k corre sólo el núcleo con ese nombre (p. ej. -k hash_string)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "hash.h"
+#include "index.h"
+#include "swiss.h"
+#include "util.h"
+
+#define MAX_RECORD 8192
+#define WARMUP_RUNS 3
+#define CHAIN_RANGE 12      /* igual que BUCKET_RANGE de search.c */
+
+static uint64_t cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/* Datos de entrada compartidos por los núcleos. */
+typedef struct {
+    char **records;         /* registros completos del CSV */
+    char **titles;          /* columna 4 de cada registro */
+    char **needles;         /* fragmentos de título (2 palabras) */
+    int n;
+    IndexMap map;
+    int has_map;
+    SwissMap swiss;
+    int has_swiss;
+} Inputs;
+
+/* El resultado de cada núcleo se acumula aquí para que el compilador no
+ * elimine las llamadas. */
+static volatile unsigned long sink;
+
+typedef long (*KernelFn)(const Inputs *in);
+
+typedef struct {
+    const char *name;
+    KernelFn fn;            /* una vuelta; devuelve el número de operaciones */
+    int needs;              /* NEEDS_* */
+} Kernel;
+
+#define NEEDS_INDEX 1       /* index.bin */
+#define NEEDS_SWISS 2       /* index.swt */
+
+static long k_hash_string(const Inputs *in) {
+    unsigned long acc = 0;
+    for (int i = 0; i < in->n; ++i) acc += hash_string(in->titles[i]);
+    sink += acc;
+    return in->n;
+}
+
+static long k_hash_wy64(const Inputs *in) {
+    unsigned long acc = 0;
+    for (int i = 0; i < in->n; ++i) acc += hash_key(HASH_WY64, in->titles[i]);
+    sink += acc;
+    return in->n;
+}
+
+/* Cada aguja contra el título vecino: mezcla de aciertos y fallos. */
+static long k_ci_strcasestr(const Inputs *in) {
+    unsigned long acc = 0;
+    for (int i = 0; i < in->n; ++i) {
+        acc += ci_strcasestr(in->titles[i], in->needles[i]) != NULL;
+        acc += ci_strcasestr(in->titles[i], in->needles[(i + 1) % in->n]) != NULL;
+    }
+    sink += acc;
+    return 2L * in->n;
+}
+
+/* update_date (columna 12): hay que saltar el abstract entre comillas. */
+static long k_csv_get_column(const Inputs *in) {
+    char out[64];
+    unsigned long acc = 0;
+    for (int i = 0; i < in->n; ++i) {
+        acc += (unsigned long)csv_get_column(in->records[i], 12, out, sizeof(out));
+        acc += (unsigned char)out[0];
+    }
+    sink += acc;
+    return in->n;
+}
+
+static long k_trim_inplace(const Inputs *in) {
+    char buf[KEY_SIZE + 8];
+    unsigned long acc = 0;
+    for (int i = 0; i < in->n; ++i) {
+        size_t len = strnlen(in->titles[i], KEY_SIZE - 1);
+        buf[0] = ' ';
+        buf[1] = ' ';
+        memcpy(buf + 2, in->titles[i], len);
+        memcpy(buf + 2 + len, "  \n", 4);
+        trim_inplace(buf);
+        acc += (unsigned char)buf[0];
+    }
+    sink += acc;
+    return in->n;
+}
+
+static long k_field_is(const Inputs *in) {
+    static const char *fields[] = { "title", " Update_Date ", "update-date", "__status", "TITLE" };
+    unsigned long acc = 0;
+    for (int i = 0; i < in->n; ++i) {
+        acc += (unsigned long)field_is(fields[i % 5], "title");
+        acc += (unsigned long)field_is(fields[i % 5], "update_date");
+    }
+    sink += acc;
+    return 2L * in->n;
+}
+
+/* Recorrido de consulta sin leer el CSV: los buckets a ±CHAIN_RANGE del hash
+ * de cada aguja, comparando cada clave. Una operación = una entrada visitada. */
+static long k_chain_walk(const Inputs *in) {
+    const IndexMap *m = &in->map;
+    long n_buckets = m->header->n_buckets;
+    long visited = 0;
+    unsigned long acc = 0;
+    int n_queries = in->n < 64 ? in->n : 64;
+    for (int i = 0; i < n_queries; ++i) {
+        long h = (long)(hash_key(m->header->hash_id, in->needles[i]) % (unsigned long)n_buckets);
+        long lo = h - CHAIN_RANGE < 0 ? 0 : h - CHAIN_RANGE;
+        long hi = h + CHAIN_RANGE >= n_buckets ? n_buckets - 1 : h + CHAIN_RANGE;
+        for (long b = lo; b <= hi; ++b) {
+            for (long off = m->buckets[b].first_entry_offset; off != -1; ) {
+                const EntryDisk *e = index_map_entry(m, off);
+                if (!e) break;
+                acc += ci_strcasestr(e->key, in->needles[i]) != NULL;
+                visited++;
+                off = e->next_entry;
+            }
+        }
+    }
+    sink += acc;
+    return visited;
+}
+
+/* Búsqueda exacta de cada título en index.bin: el bucket de su hash,
+ * comparando la forma normalizada de cada clave (como REQ_EXACT sin -x). */
+static long k_chain_exact(const Inputs *in) {
+    const IndexMap *m = &in->map;
+    long n_buckets = m->header->n_buckets;
+    unsigned long acc = 0;
+    char norm[KEY_SIZE], key[KEY_SIZE];
+    for (int i = 0; i < in->n; ++i) {
+        hash_normalize(in->titles[i], norm, sizeof(norm));
+        long b = (long)(hash_key(m->header->hash_id, in->titles[i]) % (unsigned long)n_buckets);
+        for (long off = m->buckets[b].first_entry_offset; off != -1; ) {
+            const EntryDisk *e = index_map_entry(m, off);
+            if (!e) break;
+            hash_normalize(e->key, key, sizeof(key));
+            acc += strcmp(key, norm) == 0;
+            off = e->next_entry;
+        }
+    }
+    sink += acc;
+    return in->n;
+}
+
+/* Lo mismo en index.swt: grupos de control y slots, sin cadenas. */
+static long k_swiss_lookup(const Inputs *in) {
+    unsigned long acc = 0;
+    char norm[KEY_SIZE];
+    uint64_t offsets[4];
+    long groups;
+    for (int i = 0; i < in->n; ++i) {
+        hash_normalize(in->titles[i], norm, sizeof(norm));
+        acc += (unsigned long)swiss_lookup(&in->swiss, norm, offsets, 4, &groups);
+    }
+    sink += acc;
+    return in->n;
+}
+
+static const Kernel kernels[] = {
+    { "hash_string", k_hash_string, 0 },
+    { "hash_wy64", k_hash_wy64, 0 },
+    { "ci_strcasestr", k_ci_strcasestr, 0 },
+    { "csv_get_column", k_csv_get_column, 0 },
+    { "trim_inplace", k_trim_inplace, 0 },
+    { "field_is", k_field_is, 0 },
+    { "chain_walk", k_chain_walk, NEEDS_INDEX },
+    { "chain_exact", k_chain_exact, NEEDS_INDEX },
+    { "swiss_lookup", k_swiss_lookup, NEEDS_SWISS },
+};
+#define N_KERNELS (int)(sizeof(kernels) / sizeof(kernels[0]))
+
+/* --- estadística --- */
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Mediana de v (lo reordena). */
+static double median(double *v, int n) {
+    qsort(v, (size_t)n, sizeof(double), cmp_double);
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+}
+
+/* Mediana y MAD de v[0..n); v queda reordenado. */
+static void median_mad(double *v, int n, double *med, double *mad) {
+    *med = median(v, n);
+    for (int i = 0; i < n; ++i) v[i] = v[i] > *med ? v[i] - *med : *med - v[i];
+    *mad = median(v, n);
+}
+
+static void run_kernel(const Kernel *k, const Inputs *in, int runs) {
+    double *ns = malloc(sizeof(double) * (size_t)runs);
+    double *cyc = malloc(sizeof(double) * (size_t)runs);
+    if (!ns || !cyc) { free(ns); free(cyc); return; }
+    long ops = 0;
+    for (int r = 0; r < WARMUP_RUNS; ++r) ops = k->fn(in);
+    for (int r = 0; r < runs; ++r) {
+        long long t0 = now_ns();
+        uint64_t c0 = cycles();
+        ops = k->fn(in);
+        uint64_t c1 = cycles();
+        long long t1 = now_ns();
+        if (ops <= 0) ops = 1;
+        ns[r] = (double)(t1 - t0) / (double)ops;
+        cyc[r] = (double)(c1 - c0) / (double)ops;
+    }
+    double ns_med, ns_mad, cyc_med, cyc_mad;
+    median_mad(ns, runs, &ns_med, &ns_mad);
+    median_mad(cyc, runs, &cyc_med, &cyc_mad);
+    printf("%-16s %10ld %12.2f %10.2f %12.1f %10.1f\n", k->name, ops, ns_med, ns_mad, cyc_med, cyc_mad);
+    free(ns);
+    free(cyc);
+}
+
+/* --- entrada --- */
+
+static char *dup_field(const char *s) {
+    char *d = strdup(s);
+    if (!d) { fprintf(stderr, "Sin memoria\n"); exit(1); }
+    return d;
+}
+
+/* Carga hasta max registros del CSV (saltando el encabezado). */
+static int load_inputs(Inputs *in, const char *csv_path, int max) {
+    int fd = open(csv_path, O_RDONLY);
+    if (fd < 0) { perror(csv_path); return -1; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) { fprintf(stderr, "CSV vacío: %s\n", csv_path); close(fd); return -1; }
+    const char *csv = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (csv == MAP_FAILED) { perror("mmap"); return -1; }
+
+    in->records = calloc((size_t)max, sizeof(char *));
+    in->titles = calloc((size_t)max, sizeof(char *));
+    in->needles = calloc((size_t)max, sizeof(char *));
+    if (!in->records || !in->titles || !in->needles) { fprintf(stderr, "Sin memoria\n"); return -1; }
+
+    size_t size = (size_t)st.st_size;
+    size_t off = csv_record_len(csv, size);   /* encabezado */
+    char rec[MAX_RECORD], title[KEY_SIZE];
+    while (off < size && in->n < max) {
+        size_t len = csv_record_len(csv + off, size - off);
+        size_t copy = len < sizeof(rec) ? len : sizeof(rec) - 1;
+        memcpy(rec, csv + off, copy);
+        rec[copy] = '\0';
+        off += len;
+        if (!csv_get_column(rec, 4, title, sizeof(title)) || title[0] == '\0') continue;
+
+        /* aguja: dos palabras del medio del título, o el título entero */
+        char needle[KEY_SIZE];
+        const char *sp = strchr(title + strlen(title) / 3, ' ');
+        if (sp && sp[1]) {
+            snprintf(needle, sizeof(needle), "%s", sp + 1);
+            char *a = strchr(needle, ' ');
+            char *b = a ? strchr(a + 1, ' ') : NULL;
+            if (b) *b = '\0';
+        } else {
+            snprintf(needle, sizeof(needle), "%s", title);
+        }
+
+        in->records[in->n] = dup_field(rec);
+        in->titles[in->n] = dup_field(title);
+        in->needles[in->n] = dup_field(needle);
+        in->n++;
+    }
+    munmap((void *)csv, size);
+    if (in->n == 0) { fprintf(stderr, "Sin registros en %s\n", csv_path); return -1; }
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Uso: %s [-c arxiv.csv] [-i index.bin] [-x index.swt] [-n registros] [-r vueltas] [-k kernel]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    const char *csv_path = "arxiv.csv", *index_path = "index.bin", *swiss_path = SWISS_FILE, *only = NULL;
+    int max_records = 4096, runs = 31;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:i:x:n:r:k:")) != -1) {
+        switch (opt) {
+        case 'c': csv_path = optarg; break;
+        case 'i': index_path = optarg; break;
+        case 'x': swiss_path = optarg; break;
+        case 'n': max_records = atoi(optarg); break;
+        case 'r': runs = atoi(optarg); break;
+        case 'k': only = optarg; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (max_records < 1 || runs < 1) { usage(argv[0]); return 1; }
+
+    Inputs in;
+    memset(&in, 0, sizeof(in));
+    if (load_inputs(&in, csv_path, max_records) != 0) return 1;
+    in.has_map = index_map_open(&in.map, index_path, csv_path) == 0;
+    if (!in.has_map)
+        fprintf(stderr, "Sin %s válido: se omiten chain_walk y chain_exact (./p1-search -B lo construye)\n", index_path);
+    in.has_swiss = swiss_open(&in.swiss, swiss_path) == 0;
+    if (!in.has_swiss)
+        fprintf(stderr, "Sin %s válido: se omite swiss_lookup (./p1-search -X -B lo construye)\n", swiss_path);
+
+    printf("# %d registros de %s, %d vueltas (+%d de calentamiento)\n", in.n, csv_path, runs, WARMUP_RUNS);
+    printf("%-16s %10s %12s %10s %12s %10s\n", "kernel", "ops/vuelta", "ns/op", "MAD ns", "ciclos/op", "MAD ciclos");
+    int matched = 0;
+    for (int i = 0; i < N_KERNELS; ++i) {
+        if (only && strcmp(only, kernels[i].name) != 0) continue;
+        matched = 1;
+        if ((kernels[i].needs & NEEDS_INDEX) && !in.has_map) continue;
+        if ((kernels[i].needs & NEEDS_SWISS) && !in.has_swiss) continue;
+        run_kernel(&kernels[i], &in, runs);
+    }
+    if (only && !matched) { fprintf(stderr, "Kernel desconocido: %s\n", only); return 1; }
+
+    if (in.has_map) index_map_close(&in.map);
+    if (in.has_swiss) swiss_close(&in.swiss);
+    for (int i = 0; i < in.n; ++i) { free(in.records[i]); free(in.titles[i]); free(in.needles[i]); }
+    free(in.records);
+    free(in.titles);
+    free(in.needles);
+    return 0;
+}
@@ -0,0 +1,106 @@
+#!/bin/sh
+# p1-scaling.sh
+#
+# Barrido de escalabilidad: para cada tamaño de dataset genera un arxiv.csv
+# sintético (p1-gencsv), mide la construcción del índice (p1-search -B) y,
+# para cada número de hilos del daemon, el servicio de consultas (p1-bench).
+# Escribe en stdout una tabla CSV con throughput, latencias, speedup y
+# eficiencia respecto de 1 hilo, y el desglose de la latencia media:
+# cola, ejecución e IPC (transporte) según server_mean_us, y las etapas walk,
+# match y fetch de la ejecución. Así se ve cuál deja de escalar primero.
+#
+# La construcción del índice es secuencial (un hilo): se reporta una fila
+# "build" por tamaño con hilos = 1.
+#
+# Uso:
+#  ./p1-scaling.sh [-r "10000 100000"] [-t "1 2 4 8"] [-c clientes]
+#                  [-n peticiones] [-w calentamiento] [-s semilla] [-d dir]
+#    -r     tamaños (filas) a generar (por defecto "10000 100000")
+#    -t     hilos del daemon (por defecto 1, 2, 4, ... hasta los núcleos)
+#    -c     clientes concurrentes (por defecto 2 x el máximo de hilos)
+#    -n     peticiones medidas por punto (por defecto 2000)
+#    -w     peticiones de calentamiento por punto (por defecto 200)
+#    -s     semilla de p1-gencsv (por defecto 1)
+#    -d     directorio de trabajo (por defecto scaling/; un subdirectorio
+#           por tamaño, con su CSV, índice y el registro de cada daemon)
+
+set -e
+
+BIN=$(cd "$(dirname "$0")" && pwd)
+ROWS="10000 100000"
+THREADS=""
+CLIENTS=""
+REQUESTS=2000
+WARMUP=200
+SEED=1
+WORK=scaling
+
+while getopts "r:t:c:n:w:s:d:" opt; do
+    case $opt in
+    r) ROWS=$OPTARG ;;
+    t) THREADS=$OPTARG ;;
+    c) CLIENTS=$OPTARG ;;
+    n) REQUESTS=$OPTARG ;;
+    w) WARMUP=$OPTARG ;;
+    s) SEED=$OPTARG ;;
+    d) WORK=$OPTARG ;;
+    *) sed -n '15,17p' "$0" | sed 's/^# *//' >&2; exit 1 ;;
+    esac
+done
+
+if [ -z "$THREADS" ]; then
+    ncpu=$(nproc 2>/dev/null || echo 1)
+    t=1
+    while [ "$t" -lt "$ncpu" ]; do THREADS="$THREADS $t"; t=$((t * 2)); done
+    THREADS="$THREADS $ncpu"
+fi
+max_t=1
+for t in $THREADS; do [ "$t" -gt "$max_t" ] && max_t=$t; done
+[ -n "$CLIENTS" ] || CLIENTS=$((max_t * 2))
+
+for b in p1-gencsv p1-search p1-bench; do
+    [ -x "$BIN/$b" ] || { echo "Falta $BIN/$b (make)" >&2; exit 1; }
+done
+mkdir -p "$WORK"
+WORK=$(cd "$WORK" && pwd)
+
+now_ms() { echo $(($(date +%s%N) / 1000000)); }
+
+# json_num ARCHIVO CLAVE: primer valor numérico de "CLAVE": en la salida de p1-bench
+json_num() { grep -o "\"$2\": [0-9.]*" "$1" | head -n 1 | sed 's/.*: //'; }
+
+echo "rows,phase,threads,clients,seconds,throughput_rps,speedup,efficiency,p50_us,p99_us,queue_us,exec_us,ipc_us,walk_us,match_us,fetch_us"
+
+for rows in $ROWS; do
+    dir="$WORK/rows-$rows"
+    mkdir -p "$dir"
+    cd "$dir"
+    [ -f arxiv.csv ] && [ -f queries.txt ] || "$BIN/p1-gencsv" -n "$rows" -s "$SEED" -o arxiv.csv -q queries.txt >/dev/null
+
+    rm -f index.bin
+    t0=$(now_ms)
+    "$BIN/p1-search" -B > build.log 2>&1
+    t1=$(now_ms)
+    secs=$(awk "BEGIN { printf \"%.3f\", ($t1 - $t0) / 1000 }")
+    echo "$rows,build,1,0,$secs,,,,,,,,,,,"
+
+    base=""
+    for t in $THREADS; do
+        # -q 0: sin descartar peticiones, para medir capacidad y no BUSY
+        "$BIN/p1-search" -F -t "$t" -q 0 -s "$dir/sock" -R - > "search-$t.log" 2>&1 &
+        pid=$!
+        if ! "$BIN/p1-bench" -f queries.txt -s "$dir/sock" -c "$CLIENTS" -n "$REQUESTS" \
+                -w "$WARMUP" -S > "bench-$t.json" 2> "bench-$t.err"; then
+            kill "$pid" 2>/dev/null; wait "$pid" 2>/dev/null || true
+            echo "p1-bench falló con $t hilos ($dir/bench-$t.err)" >&2
+            exit 1
+        fi
+        kill "$pid"; wait "$pid" 2>/dev/null || true
+
+        j="bench-$t.json"
+        rps=$(json_num "$j" throughput_rps)
+        [ -n "$base" ] || base=$(awk "BEGIN { print $rps / $t }")
+        echo "$rows,serve,$t,$CLIENTS,$(json_num "$j" duration_s),$rps,$(awk "BEGIN {
+            s = $rps / $base; printf \"%.2f,%.2f\", s, s / $t }"),$(json_num "$j" p50),$(json_num "$j" p99),$(json_num "$j" queue),$(json_num "$j" exec),$(json_num "$j" ipc),$(json_num "$j" walk),$(json_num "$j" match),$(json_num "$j" fetch)"
+    done
+done
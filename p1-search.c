@@ -1,324 +1,329 @@
 /* search_worker.c
  *
- * Worker que se comunica binariamente con la UI mediante Request/Response (common.h).
+ * Daemon de búsqueda: se comunica binariamente con la UI mediante Request/Response (common.h).
  * Búsqueda por SUBCADENA (case-insensitive) en title + filtro opcional update_date (col 12).
  *
+ * Atiende a la vez el protocolo FIFO original (FIFO_REQ/FIFO_RES) y un socket
+ * UNIX (SOCK_PATH) con muchas conexiones, multiplexados por un bucle epoll
+ * (server.c). Las búsquedas se ejecutan en un pool de hilos (pool.c).
+ *
+ * Con -P N el proceso queda como supervisor: crea el socket, construye y
+ * proyecta el índice (mmap de sólo lectura) y lanza N procesos trabajadores
+ * con fork() que heredan ambos. Si un trabajador muere, se relanza; el resto
+ * sigue atendiendo. El trabajador 0 atiende además los FIFOs.
+ *
+ * SIGHUP recarga el índice en caliente (search_reload): si arxiv.csv es más
+ * nuevo que index.bin se construye uno nuevo en segundo plano, si index.bin
+ * fue reemplazado (p. ej. con -B) se proyecta, y la nueva generación entra en
+ * servicio sin cortar las consultas en curso. En modo pre-fork el supervisor
+ * construye y reenvía SIGHUP a los trabajadores, que sólo reproyectan.
+ *
+ * SIGUSR1 vuelca en stderr las métricas del proceso (stats.c): contadores,
+ * latencias y tiempos por etapa de las consultas medidas (REQ_TIMING o, con
+ * -M, todas); lo mismo que responde una Request STATS_TAG. En modo pre-fork
+ * el supervisor la reenvía y cada trabajador vuelca las suyas.
+ *
  * Requisitos:
- *  - common.h (FIFO_REQ, FIFO_RES, Request, Response)
- *  - index.h (IndexHeader, BucketDisk, EntryDisk, KEY_SIZE, N_BUCKETS)
- *  - hash.h / hash.c (hash_string)
- *  - build_index(...) en index2.c
+ *  - common.h (FIFO_REQ, FIFO_RES, SOCK_PATH, Request, Response)
+ *  - search.c (ejecución de consultas), server.c (bucle de eventos), pool.c
+ *  - stats.c (métricas), perfctr.c (contadores de hardware, -H),
+ *    slowlog.c (registro de consultas lentas, -S)
+ *  - index.h / index2.c (build_index), hash.h / hash.c (hash_key),
+ *    mph.h / mph.c y swiss.h / swiss.c (índices exactos, -x / -X),
+ *    btree.h / btree.c (árbol B+, -b), suggest.h / suggest.c (autocompletado, -A),
+ *    sarray.h / sarray.c (arreglo de sufijos, -U)
  *
- * Compilar ejemplo:
- *  gcc -std=c11 -O2 -o search_worker search_worker.c index2.c hash.c
+ * Uso:
+ *  ./p1-search [-t hilos] [-s socket] [-F] [-T ms] [-q N] [-P procesos]
+ *  ./p1-search -B          (construye index.bin desde arxiv.csv y termina)
+ *    -k H   función hash de los índices que se construyan: wy64 (por
+ *           defecto) o djb2; uno ya construido sigue con la suya (header)
+ *    -x     índice exacto (mph.c, MPH_FILE): las consultas REQ_EXACT se
+ *           resuelven con una sonda en vez de recorrer buckets; se construye
+ *           junto con index.bin (también con -B) y se recarga con él
+ *    -X     lo mismo con una tabla de direccionamiento abierto (swiss.c,
+ *           SWISS_FILE): grupos de 16 huellas de un byte comparados con
+ *           SSE2, con los títulos guardados aparte
+ *    -b     index.bin con árbol B+ sobre los títulos (btree.c): consultas por
+ *           prefijo (REQ_PREFIX) y rango (REQ_RANGE), y exactas en orden de
+ *           título; uno sin árbol se reconstruye
+ *    -A     autocompletado (suggest.c): trie comprimido en memoria sobre los
+ *           títulos, armado con cada generación del índice; responde las
+ *           Request SUGGEST_TAG con los k títulos más pesados del prefijo y
+ *           las búsquedas aproximadas (REQ_FUZZY, distancia de edición)
+ *    -U     arreglo de sufijos (sarray.c, SARRAY_FILE) sobre los títulos: las
+ *           búsquedas por subcadena devuelven todos los títulos que contienen
+ *           el valor, y REQ_COUNT cuenta cuántos; se construye junto con
+ *           index.bin (también con -B) y se recarga con él
+ *    -W     precargar las páginas del índice al arrancar (y al recargar)
+ *    -L     además fijarlas en RAM con mlock (ver ulimit -l)
+ *    -R P   archivo de "listo" (por defecto READY_FILE); "-" para no crearlo
+ *    -M     medir las etapas de todas las consultas (no sólo las REQ_TIMING)
+ *    -H     contadores de hardware (perf_event_open) por recorrido (perfctr.c)
+ *    -S ms  registrar las consultas que tarden más de ms (llegada → respuesta)
+ *           con su perfil de ejecución en el registro de lentas (slowlog.c)
+ *    -O P   archivo de ese registro (por defecto SLOW_LOG_FILE, se agrega)
+ *
+ * Arranque: el índice se construye (si falta, está desactualizado o tiene otro
+ * formato) y se proyecta antes de la primera consulta, en un hilo aparte; el
+ * daemon atiende desde el principio y, hasta estar listo, responde "LOADING"
+ * (RES_LOADING) en vez de bloquear al cliente. Al terminar escribe su pid en
+ * el archivo de listo; una Request STATUS_TAG informa el estado.
+ *    -t N   hilos trabajadores (por defecto, núcleos en línea)
+ *    -s P   ruta del socket UNIX (por defecto SOCK_PATH)
+ *    -F     no atender los FIFOs (sólo socket)
+ *    -T ms  plazo por defecto de cada consulta (0: sin plazo); al agotarse se
+ *           responde con lo encontrado y RES_TRUNCATED
+ *    -q N   máximo de peticiones esperando un hilo (por defecto 64; 0: sin
+ *           límite); las que excedan se responden "BUSY" con RES_BUSY
+ *    -P N   modo pre-fork: N procesos trabajadores (con -t hilos cada uno)
  */
 
 #define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <strings.h>   /* strcasecmp, strncasecmp */
-#include <ctype.h>
 #include <unistd.h>
-#include <fcntl.h>
-#include <sys/stat.h>
+#include <signal.h>
 #include <errno.h>
 #include <time.h>
-
-#include "common.h"    /* FIFO_REQ, FIFO_RES, Request, Response */
-#include "index.h"
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <pthread.h>
+
+#include "common.h"    /* FIFO_REQ, FIFO_RES, SOCK_PATH, Request, Response */
+#include "pool.h"
+#include "search.h"
+#include "server.h"
+#include "stats.h"
+#include "perfctr.h"
+#include "slowlog.h"
 #include "hash.h"
+#include "index.h"     /* INDEX_TYPE_BTREE */
 
-#ifndef KEY_SIZE
-#define KEY_SIZE 256
-#endif
+#define RESPAWN_MIN_SEC 1   /* un trabajador que muere antes se relanza con pausa */
 
-#define CSV_FILE "arxiv.csv"
-#define INDEX_FILE "index.bin"
-#define MAX_LINE 8192
-#define MAX_RESULTS 50
-#define BUCKET_RANGE 12    /* heurística: escanear vecinos alrededor del bucket */
+static volatile sig_atomic_t stop_requested;
+static volatile sig_atomic_t reload_requested;
+static volatile sig_atomic_t dump_requested;
 
-int build_index(const char *csv_path, const char *index_path);
-
-/* Portable case-insensitive substring search */
-static char *ci_strcasestr(const char *haystack, const char *needle) {
-    if (!haystack || !needle) return NULL;
-    size_t needle_len = strlen(needle);
-    if (needle_len == 0) return (char *)haystack;
-    for (const char *p = haystack; *p; ++p) {
-        size_t rem = strlen(p);
-        if (rem < needle_len) return NULL;
-        if (strncasecmp(p, needle, needle_len) == 0) return (char *)p;
-    }
-    return NULL;
+static void usage(const char *prog) {
+    fprintf(stderr, "Uso: %s [-t hilos] [-s socket] [-F] [-T ms] [-q N] [-P procesos] [-W] [-L] [-R archivo] [-M] [-H] [-S ms] [-O archivo] [-k hash] [-x | -X] [-b] [-A] [-U] | -B\n", prog);
 }
 
-/* trim both ends */
-static void trim_inplace(char *s) {
-    if (!s) return;
-    char *a = s;
-    while (*a && isspace((unsigned char)*a)) a++;
-    if (a != s) memmove(s, a, strlen(a)+1);
-    size_t n = strlen(s);
-    while (n > 0 && isspace((unsigned char)s[n-1])) { s[n-1] = '\0'; n--; }
+static void on_stop(int sig) {
+    (void)sig;
+    stop_requested = 1;
 }
 
-/* Parse CSV column (1-based) with basic quote support */
-static int csv_get_column(const char *line, int target_col, char *out, size_t out_sz) {
-    int col = 1;
-    const char *p = line;
-    while (*p && *p != '\n' && *p != '\r') {
-        if (col == target_col) {
-            if (*p == '"') {
-                p++; /* skip " */
-                size_t pos = 0;
-                while (*p) {
-                    if (*p == '"') {
-                        if (*(p+1) == '"') {
-                            if (pos + 1 < out_sz) out[pos++] = '"';
-                            p += 2;
-                            continue;
-                        } else { p++; break; } /* end quote */
-                    }
-                    if (pos + 1 < out_sz) out[pos++] = *p;
-                    p++;
-                }
-                out[pos] = '\0';
-                trim_inplace(out);
-                return 1;
-            } else {
-                const char *start = p;
-                while (*p && *p != ',' && *p != '\n' && *p != '\r') p++;
-                size_t len = (size_t)(p - start);
-                if (len >= out_sz) len = out_sz - 1;
-                memcpy(out, start, len);
-                out[len] = '\0';
-                trim_inplace(out);
-                return 1;
-            }
-        }
+static void on_reload(int sig) {
+    (void)sig;
+    reload_requested = 1;
+}
 
-        /* advance to next field */
-        if (*p == '"') {
-            p++;
-            while (*p) {
-                if (*p == '"' && *(p+1) != '"') { p++; break; }
-                if (*p == '"' && *(p+1) == '"') p += 2;
-                else p++;
-            }
-            if (*p == ',') { p++; col++; }
-        } else {
-            while (*p && *p != ',' && *p != '\n' && *p != '\r') p++;
-            if (*p == ',') { p++; col++; }
-        }
-    }
-    out[0] = '\0';
-    return 0;
+static void on_dump(int sig) {
+    (void)sig;
+    dump_requested = 1;
 }
 
-/* Field name match ignoring case/spaces (small helper) */
-static int field_is(const char *field, const char *target) {
-    if (!field || !target) return 0;
-    char a[128], b[128];
-    strncpy(a, field, sizeof(a)-1); a[sizeof(a)-1] = '\0'; trim_inplace(a);
-    strncpy(b, target, sizeof(b)-1); b[sizeof(b)-1] = '\0'; trim_inplace(b);
-    return strcasecmp(a, b) == 0;
+/* Bloquea SIGHUP y SIGUSR1 en el hilo actual (y en los que cree): el bucle
+ * de eventos las recibe por signalfd. */
+static void block_signals(void) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGHUP);
+    sigaddset(&set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
 }
 
-/* Search across buckets in a neighbor range using substring match for title.
- * Append matching CSV lines into resp_buf (size resp_sz). Returns number of matches
- * found (>0), 0 if none, -1 on error.
- */
-static int search_by_title_and_update(const char *title_value, const char *update_value,
-                                      char *resp_buf, size_t resp_sz) {
-    if (!title_value || resp_buf == NULL) return -1;
+static const char *ready_file = READY_FILE;
+
+/* Publica el archivo de listo (pid del daemon) de forma atómica. */
+static void write_ready_file(void) {
+    if (!ready_file) return;
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", ready_file);
+    FILE *f = fopen(tmp, "w");
+    if (!f) { perror(tmp); return; }
+    fprintf(f, "%d\n", (int)getpid());
+    if (fclose(f) != 0 || rename(tmp, ready_file) != 0) { perror(ready_file); unlink(tmp); }
+}
 
-    /* Ensure index exists */
-    if (access(INDEX_FILE, F_OK) != 0) {
-        if (build_index(CSV_FILE, INDEX_FILE) != 0) return -1;
+static void *warmup_main(void *arg) {
+    (void)arg;
+    if (search_warmup() != 0) {
+        fprintf(stderr, "No se pudo abrir el índice; las consultas seguirán recibiendo LOADING\n");
+        return NULL;
     }
+    printf("Índice listo.\n");
+    fflush(stdout);
+    write_ready_file();
+    return NULL;
+}
 
-    FILE *idx = fopen(INDEX_FILE, "rb");
-    FILE *csv = fopen(CSV_FILE, "r");
-    if (!idx || !csv) {
-        if (idx) fclose(idx);
-        if (csv) fclose(csv);
-        return -1;
-    }
+/* Cuerpo de un proceso trabajador (o del daemon sin -P). */
+static int run_server(ServerConfig *cfg, int n_threads) {
+    Pool *pool = pool_create(n_threads);
+    if (!pool) { fprintf(stderr, "No se pudo crear el pool de hilos\n"); return 1; }
+    int rc = server_run(cfg, pool);
+    pool_destroy(pool);
+    return rc == 0 ? 0 : 1;
+}
 
-    /* read header */
-    IndexHeader header;
-    if (fseek(idx, 0, SEEK_SET) != 0 || fread(&header, sizeof(IndexHeader), 1, idx) != 1) {
-        fclose(idx); fclose(csv);
-        return -1;
+static pid_t spawn_worker(int slot, const ServerConfig *base, int n_threads) {
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork"); return -1; }
+    if (pid == 0) {
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGINT, SIG_DFL);
+        block_signals();
+        ServerConfig cfg = *base;
+        cfg.use_fifo = base->use_fifo && slot == 0;
+        /* el mmap ya viene del supervisor: sólo precarga/mlock de este proceso */
+        if (search_warmup() != 0) _exit(1);
+        _exit(run_server(&cfg, n_threads));
     }
-    long n_buckets = header.n_buckets;
-    if (n_buckets <= 0) n_buckets = N_BUCKETS;
-
-    unsigned long h = hash_string(title_value) % (unsigned long)n_buckets;
-
-    int found = 0;
-    size_t used = 0;
-    resp_buf[0] = '\0';
-
-    int off_start = -BUCKET_RANGE;
-    int off_end   = BUCKET_RANGE;
-
-    char linebuf[MAX_LINE];
-
-    for (int off = off_start; off <= off_end && found < MAX_RESULTS; ++off) {
-        long bucket_idx = (long)h + off;
-        if (bucket_idx < 0 || bucket_idx >= n_buckets) continue;
-
-        long bucket_offset = sizeof(IndexHeader) + sizeof(BucketDisk) * bucket_idx;
-        BucketDisk b;
-        if (fseek(idx, bucket_offset, SEEK_SET) != 0) continue;
-        if (fread(&b, sizeof(BucketDisk), 1, idx) != 1) continue;
-
-        long current = b.first_entry_offset;
-        EntryDisk entry;
-
-        while (current != -1 && found < MAX_RESULTS) {
-            if (fseek(idx, current, SEEK_SET) != 0) break;
-            if (fread(&entry, sizeof(EntryDisk), 1, idx) != 1) break;
-
-            /* substring match (case-insensitive) */
-            if (ci_strcasestr(entry.key, title_value)) {
-                /* read CSV line at offset */
-                if (fseek(csv, entry.csv_offset, SEEK_SET) == 0) {
-                    if (fgets(linebuf, sizeof(linebuf), csv)) {
-                        int pass_update = 1;
-                        if (update_value && update_value[0] != '\0') {
-                            char parsed_update[64];
-                            if (!csv_get_column(linebuf, 12, parsed_update, sizeof(parsed_update))) {
-                                pass_update = 0;
-                            } else {
-                                if (strcasecmp(parsed_update, update_value) != 0) pass_update = 0;
-                            }
-                        }
-                        if (pass_update) {
-                            /* append linebuf to resp_buf if space permits */
-                            size_t line_len = strnlen(linebuf, sizeof(linebuf));
-                            /* ensure space for at least one char and terminating null */
-                            if (used + line_len + 1 < resp_sz) {
-                                memcpy(resp_buf + used, linebuf, line_len);
-                                used += line_len;
-                                resp_buf[used] = '\0';
-                                found++;
-                            } else {
-                                /* not enough space left; stop collecting */
-                                goto FINISH_SEARCH;
-                            }
-                        }
-                    } /* fgets */
-                } /* fseek */
-            } /* if substring */
-
-            current = entry.next_entry;
-        } /* while entries */
-
-    } /* for buckets */
-
-FINISH_SEARCH:
-    fclose(idx);
-    fclose(csv);
-    return found;
+    return pid;
 }
 
-int main(void) {
-    for (;;) {
-        Request req;
-        Response res;
-        memset(&req, 0, sizeof(req));
-        memset(&res, 0, sizeof(res));
+/* Supervisor del modo pre-fork: relanza a los trabajadores que terminan y,
+ * con SIGTERM/SIGINT, los detiene a todos. */
+static int supervise(ServerConfig *cfg, int n_procs, int n_threads) {
+    cfg->listen_fd = server_listen(cfg->sock_path);
+    if (cfg->listen_fd < 0) return 1;
+    /* índice y CSV proyectados una sola vez: los hijos heredan el mmap */
+    if (search_open() != 0) {
+        fprintf(stderr, "No se pudo abrir el índice\n");
+        return 1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop;          /* sin SA_RESTART: wait() vuelve con EINTR */
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    sa.sa_handler = on_reload;
+    sigaction(SIGHUP, &sa, NULL);
+    sa.sa_handler = on_dump;
+    sigaction(SIGUSR1, &sa, NULL);
+
+    pid_t *pids = calloc((size_t)n_procs, sizeof(pid_t));
+    time_t *started = calloc((size_t)n_procs, sizeof(time_t));
+    if (!pids || !started) { free(pids); free(started); return 1; }
+    for (int i = 0; i < n_procs; ++i) {
+        pids[i] = spawn_worker(i, cfg, n_threads);
+        started[i] = time(NULL);
+    }
+    write_ready_file();
 
-        /* Blocking open/read of request FIFO */
-        int fd_in = open(FIFO_REQ, O_RDONLY);
-        if (fd_in < 0) {
-            if (errno == ENOENT) {
-                if (mkfifo(FIFO_REQ, 0666) == -1 && errno != EEXIST) {
-                    perror("mkfifo FIFO_REQ");
-                    sleep(1);
-                    continue;
-                }
-                fd_in = open(FIFO_REQ, O_RDONLY);
-                if (fd_in < 0) { perror("open FIFO_REQ"); sleep(1); continue; }
+    while (!stop_requested) {
+        if (dump_requested) {
+            dump_requested = 0;
+            for (int i = 0; i < n_procs; ++i) if (pids[i] > 0) kill(pids[i], SIGUSR1);
+        }
+        if (reload_requested) {
+            reload_requested = 0;
+            /* construye aquí una sola vez; los trabajadores sólo reproyectan */
+            if (search_reload() == 0) {
+                for (int i = 0; i < n_procs; ++i) if (pids[i] > 0) kill(pids[i], SIGHUP);
             } else {
-                perror("open FIFO_REQ");
-                sleep(1);
-                continue;
+                fprintf(stderr, "Recarga fallida: se sigue con el índice anterior\n");
             }
         }
-
-        ssize_t rr = read(fd_in, &req, sizeof(req));
-        close(fd_in);
-        if (rr != (ssize_t)sizeof(req)) {
-            /* ignore bad/partial reads and wait for next request */
-            continue;
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            if (errno == ECHILD) sleep(RESPAWN_MIN_SEC);   /* todos los fork fallaron */
         }
-
-        /* Extract title and update_date values (supports either field position) */
-        char title_val[KEY_SIZE]; title_val[0] = '\0';
-        char update_val[64]; update_val[0] = '\0';
-
-        if (field_is(req.field_name1, "title")) {
-            strncpy(title_val, req.value1, sizeof(title_val)-1);
-            title_val[sizeof(title_val)-1] = '\0';
-            trim_inplace(title_val);
-        } else if (field_is(req.field_name2, "title")) {
-            strncpy(title_val, req.value2, sizeof(title_val)-1);
-            title_val[sizeof(title_val)-1] = '\0';
-            trim_inplace(title_val);
+        for (int i = 0; i < n_procs && !stop_requested; ++i) {
+            if (pid > 0 && pids[i] != pid) continue;
+            if (pid < 0 && pids[i] > 0) continue;
+            if (pid > 0) {
+                if (WIFSIGNALED(status))
+                    fprintf(stderr, "Trabajador %d (pid %d) terminó por la señal %d; se relanza\n",
+                            i, (int)pid, WTERMSIG(status));
+                else
+                    fprintf(stderr, "Trabajador %d (pid %d) salió con código %d; se relanza\n",
+                            i, (int)pid, WEXITSTATUS(status));
+                if (time(NULL) - started[i] < RESPAWN_MIN_SEC) sleep(RESPAWN_MIN_SEC);
+            }
+            pids[i] = spawn_worker(i, cfg, n_threads);
+            started[i] = time(NULL);
         }
+    }
 
-        if (field_is(req.field_name1, "update_date") || field_is(req.field_name1, "updatedate") || field_is(req.field_name1, "update-date")) {
-            strncpy(update_val, req.value1, sizeof(update_val)-1);
-            update_val[sizeof(update_val)-1] = '\0';
-            trim_inplace(update_val);
-        } else if (field_is(req.field_name2, "update_date") || field_is(req.field_name2, "updatedate") || field_is(req.field_name2, "update-date")) {
-            strncpy(update_val, req.value2, sizeof(update_val)-1);
-            update_val[sizeof(update_val)-1] = '\0';
-            trim_inplace(update_val);
-        }
+    for (int i = 0; i < n_procs; ++i) if (pids[i] > 0) kill(pids[i], SIGTERM);
+    while (wait(NULL) > 0 || errno == EINTR) {}
+    unlink(cfg->sock_path);
+    if (ready_file) unlink(ready_file);
+    free(pids);
+    free(started);
+    return 0;
+}
 
-        /* If no title provided -> UI expects NA */
-        if (title_val[0] == '\0') {
-            strncpy(res.result, "NA", sizeof(res.result)-1);
-        } else {
-            char buf[sizeof(res.result)];
-            memset(buf, 0, sizeof(buf));
-            int found = search_by_title_and_update(title_val, (update_val[0] ? update_val : NULL),
-                                                  buf, sizeof(buf));
-            if (found <= 0) {
-                strncpy(res.result, "NA", sizeof(res.result)-1);
-            } else {
-                /* copy collected results into res.result (already fits) */
-                strncpy(res.result, buf, sizeof(res.result)-1);
-                res.result[sizeof(res.result)-1] = '\0';
-            }
+int main(int argc, char **argv) {
+    long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_threads < 1) n_threads = 1;
+
+    ServerConfig cfg = { .sock_path = SOCK_PATH, .use_fifo = 1, .max_queue = 64, .listen_fd = -1 };
+    int n_procs = 0;
+    int build_only = 0;
+    int slow_ms = -1;
+    const char *slow_log = SLOW_LOG_FILE;
+    SearchOptions sopts = { .default_timeout_ms = 0, .hash_id = HASH_DEFAULT };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:s:FT:q:P:BWLR:MHS:O:k:xXbAU")) != -1) {
+        switch (opt) {
+        case 't': n_threads = atol(optarg); break;
+        case 's': cfg.sock_path = optarg; break;
+        case 'F': cfg.use_fifo = 0; break;
+        case 'T': sopts.default_timeout_ms = atoi(optarg); break;
+        case 'q': cfg.max_queue = atoi(optarg); break;
+        case 'P': n_procs = atoi(optarg); break;
+        case 'B': build_only = 1; break;
+        case 'W': sopts.prefault = 1; break;
+        case 'L': sopts.lock_memory = 1; break;
+        case 'R': ready_file = strcmp(optarg, "-") == 0 ? NULL : optarg; break;
+        case 'M': stats_configure(1); break;
+        case 'H': perfctr_configure(1); break;
+        case 'S': slow_ms = atoi(optarg); break;
+        case 'O': slow_log = optarg; break;
+        case 'k':
+            if ((sopts.hash_id = hash_by_name(optarg)) < 0) { usage(argv[0]); return 1; }
+            break;
+        case 'x': sopts.exact_index = EXACT_INDEX_MPH; break;
+        case 'X': sopts.exact_index = EXACT_INDEX_SWISS; break;
+        case 'b': sopts.index_type = INDEX_TYPE_BTREE; break;
+        case 'A': sopts.suggest = 1; break;
+        case 'U': sopts.suffix_array = 1; break;
+        default: usage(argv[0]); return 1;
         }
+    }
+    if (n_threads < 1 || sopts.default_timeout_ms < 0 || cfg.max_queue < 0 || n_procs < 0) { usage(argv[0]); return 1; }
+    search_configure(&sopts);
+    if (build_only) return search_build() == 0 ? 0 : 1;
+    /* antes del fork: en pre-fork los trabajadores comparten el descriptor */
+    if (slow_ms >= 0 && slowlog_open(slow_log, slow_ms) != 0) {
+        perror(slow_log);
+        return 1;
+    }
+    if (ready_file) unlink(ready_file);   /* de una ejecución anterior */
 
-        /* Write response (blocking until UI reads) */
-        int fd_out = open(FIFO_RES, O_WRONLY);
-        if (fd_out < 0) {
-            if (errno == ENOENT) {
-                if (mkfifo(FIFO_RES, 0666) == -1 && errno != EEXIST) {
-                    perror("mkfifo FIFO_RES");
-                    continue;
-                }
-                fd_out = open(FIFO_RES, O_WRONLY);
-                if (fd_out < 0) { perror("open FIFO_RES"); continue; }
-            } else {
-                perror("open FIFO_RES");
-                continue;
-            }
-        }
+    /* un cliente que cierra antes de leer no debe matar al daemon */
+    signal(SIGPIPE, SIG_IGN);
 
-        ssize_t ww = write(fd_out, &res, sizeof(res));
-        (void)ww; /* ignore partial-write complexities (UI expects sizeof) */
-        close(fd_out);
+    if (n_procs > 0) {
+        if (!cfg.sock_path) { usage(argv[0]); return 1; }
+        return supervise(&cfg, n_procs, (int)n_threads);
     }
-
-    return 0;
+    block_signals();
+    pthread_t warmup;
+    if (pthread_create(&warmup, NULL, warmup_main, NULL) != 0) {
+        perror("pthread_create (arranque)");
+        return 1;
+    }
+    pthread_detach(warmup);
+    return run_server(&cfg, (int)n_threads);
 }
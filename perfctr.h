@@ -0,0 +1,25 @@
+#ifndef PERFCTR_H
+#define PERFCTR_H
+
+/* Contadores de hardware por hilo con perf_event_open (opcional, -H).
+ * Cada hilo abre sus contadores la primera vez que lee; si el kernel o la
+ * máquina no los ofrecen (VM sin PMU, perf_event_paranoid), los valores
+ * quedan en 0 y perfctr_available() lo indica. */
+
+enum { HW_CYCLES, HW_INSTRUCTIONS, HW_LLC_MISSES, HW_BRANCH_MISSES, HW_PAGE_FAULTS, N_HW };
+
+extern const char *const hw_names[N_HW];
+
+/* Activa la medición (al arrancar, antes de crear hilos). */
+void perfctr_configure(int enabled);
+
+/* 1 si se pidió la medición. */
+int perfctr_enabled(void);
+
+/* Bits (1 << HW_*) de los contadores que algún hilo pudo abrir. */
+int perfctr_available(void);
+
+/* Valores actuales de los contadores del hilo que llama (0 los que no hay). */
+void perfctr_read(unsigned long long v[N_HW]);
+
+#endif
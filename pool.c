@@ -0,0 +1,259 @@
+/* pool.c
+ * Pool de hilos con robo de trabajo.
+ *  - Cada hilo tiene una deque protegida por su propio mutex: el dueño empuja
+ *    y saca por abajo (LIFO), los ladrones roban por arriba (FIFO), así que
+ *    casi nunca compiten por el mismo extremo ni por el mismo lock.
+ *  - pool_submit usa una cola de inyección compartida (misma estructura).
+ *  - Los hilos sin trabajo duermen en una variable de condición; `pending`
+ *    cuenta las tareas encoladas y `sleepers` evita señalizar si nadie duerme.
+ *  - pool_wait, sin nada más que tomar, duerme en la condición del grupo que
+ *    la última tarea hija señaliza.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "pool.h"
+
+typedef struct {
+    TaskFn fn;
+    void *arg;
+    TaskGroup *group;
+} Task;
+
+typedef struct {
+    pthread_mutex_t lock;
+    Task *buf;              /* anillo de cap posiciones */
+    size_t cap;
+    size_t top, bottom;     /* top: extremo de robo; bottom: extremo del dueño */
+} Deque;
+
+typedef struct {
+    Pool *pool;
+    int id;
+} WorkerArg;
+
+struct Pool {
+    int n_threads;
+    int n_started;
+    pthread_t *threads;
+    WorkerArg *args;
+    Deque *deques;          /* una por hilo */
+    Deque inject;           /* tareas desde fuera del pool */
+    pthread_mutex_t sleep_lock;
+    pthread_cond_t sleep_cond;
+    atomic_long pending;    /* tareas encoladas y aún no tomadas */
+    atomic_int sleepers;
+    atomic_int stop;
+};
+
+static __thread Pool *tls_pool;
+static __thread int tls_worker = -1;
+
+/* --- deque --- */
+
+static void deque_init(Deque *d) {
+    pthread_mutex_init(&d->lock, NULL);
+    d->buf = NULL;
+    d->cap = d->top = d->bottom = 0;
+}
+
+static void deque_free(Deque *d) {
+    pthread_mutex_destroy(&d->lock);
+    free(d->buf);
+}
+
+static int deque_push(Deque *d, Task t) {
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom - d->top == d->cap) {
+        size_t cap = d->cap ? d->cap * 2 : 64;
+        Task *nb = malloc(sizeof(Task) * cap);
+        if (!nb) { pthread_mutex_unlock(&d->lock); return -1; }
+        for (size_t i = d->top; i < d->bottom; ++i) nb[i - d->top] = d->buf[i % d->cap];
+        free(d->buf);
+        d->buf = nb;
+        d->bottom -= d->top;
+        d->top = 0;
+        d->cap = cap;
+    }
+    d->buf[d->bottom % d->cap] = t;
+    d->bottom++;
+    pthread_mutex_unlock(&d->lock);
+    return 0;
+}
+
+/* from_top: 1 para robar (ladrón o cola de inyección), 0 para el dueño */
+static int deque_pop(Deque *d, int from_top, Task *out) {
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom == d->top) { pthread_mutex_unlock(&d->lock); return 0; }
+    if (from_top) *out = d->buf[d->top++ % d->cap];
+    else *out = d->buf[--d->bottom % d->cap];
+    pthread_mutex_unlock(&d->lock);
+    return 1;
+}
+
+/* --- planificación --- */
+
+static int push_task(Pool *pool, Deque *d, Task t) {
+    if (deque_push(d, t) != 0) return -1;
+    atomic_fetch_add(&pool->pending, 1);
+    if (atomic_load(&pool->sleepers) > 0) {
+        pthread_mutex_lock(&pool->sleep_lock);
+        pthread_cond_signal(&pool->sleep_cond);
+        pthread_mutex_unlock(&pool->sleep_lock);
+    }
+    return 0;
+}
+
+/* Busca trabajo: deque propia, cola de inyección y luego robo a las demás.
+ * Quien espera a un grupo (pool_wait) no toma de la cola de inyección: una
+ * petición nueva completa retrasaría la consulta que está esperando. */
+static int find_task(Pool *pool, int self, int use_inject, Task *out) {
+    int found = 0;
+    if (self >= 0) found = deque_pop(&pool->deques[self], 0, out);
+    if (!found && use_inject) found = deque_pop(&pool->inject, 1, out);
+    for (int i = 1; !found && i <= pool->n_threads; ++i) {
+        int victim = (self + i) % pool->n_threads;
+        if (victim == self) continue;
+        found = deque_pop(&pool->deques[victim], 1, out);
+    }
+    if (found) atomic_fetch_sub(&pool->pending, 1);
+    return found;
+}
+
+static void run_task(Task *t) {
+    t->fn(t->arg);
+    TaskGroup *g = t->group;
+    if (!g) return;
+    /* con el lock: quien espera no puede ver pending en 0 y destruir el grupo
+     * mientras aquí todavía se señaliza */
+    pthread_mutex_lock(&g->lock);
+    if (atomic_fetch_sub(&g->pending, 1) == 1) pthread_cond_signal(&g->done);
+    pthread_mutex_unlock(&g->lock);
+}
+
+static void *worker_main(void *p) {
+    WorkerArg *wa = p;
+    Pool *pool = wa->pool;
+    tls_pool = pool;
+    tls_worker = wa->id;
+
+    for (;;) {
+        Task t;
+        if (find_task(pool, tls_worker, 1, &t)) { run_task(&t); continue; }
+
+        pthread_mutex_lock(&pool->sleep_lock);
+        atomic_fetch_add(&pool->sleepers, 1);
+        while (atomic_load(&pool->pending) == 0 && !atomic_load(&pool->stop))
+            pthread_cond_wait(&pool->sleep_cond, &pool->sleep_lock);
+        atomic_fetch_sub(&pool->sleepers, 1);
+        int stop = atomic_load(&pool->stop) && atomic_load(&pool->pending) == 0;
+        pthread_mutex_unlock(&pool->sleep_lock);
+        if (stop) return NULL;
+    }
+}
+
+/* --- API --- */
+
+Pool *pool_create(int n_threads) {
+    if (n_threads < 1) n_threads = 1;
+    Pool *pool = calloc(1, sizeof(Pool));
+    if (!pool) return NULL;
+    pool->threads = calloc((size_t)n_threads, sizeof(pthread_t));
+    pool->args = calloc((size_t)n_threads, sizeof(WorkerArg));
+    pool->deques = calloc((size_t)n_threads, sizeof(Deque));
+    if (!pool->threads || !pool->args || !pool->deques) {
+        free(pool->threads); free(pool->args); free(pool->deques); free(pool);
+        return NULL;
+    }
+    pool->n_threads = n_threads;
+    for (int i = 0; i < n_threads; ++i) deque_init(&pool->deques[i]);
+    deque_init(&pool->inject);
+    pthread_mutex_init(&pool->sleep_lock, NULL);
+    pthread_cond_init(&pool->sleep_cond, NULL);
+
+    for (int i = 0; i < n_threads; ++i) {
+        pool->args[i].pool = pool;
+        pool->args[i].id = i;
+        if (pthread_create(&pool->threads[i], NULL, worker_main, &pool->args[i]) != 0) break;
+        pool->n_started++;
+    }
+    if (pool->n_started < n_threads) {
+        /* no se pudo crear alguno: se detienen los que arrancaron */
+        pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+int pool_submit(Pool *pool, TaskFn fn, void *arg) {
+    Task t = { fn, arg, NULL };
+    return push_task(pool, &pool->inject, t);
+}
+
+int pool_spawn(Pool *pool, TaskGroup *group, TaskFn fn, void *arg) {
+    Task t = { fn, arg, group };
+    atomic_fetch_add(&group->pending, 1);
+    Deque *d = (tls_pool == pool && tls_worker >= 0) ? &pool->deques[tls_worker] : &pool->inject;
+    if (push_task(pool, d, t) != 0) {
+        atomic_fetch_sub(&group->pending, 1);
+        return -1;
+    }
+    return 0;
+}
+
+void pool_group_init(TaskGroup *group) {
+    atomic_init(&group->pending, 0);
+    pthread_mutex_init(&group->lock, NULL);
+    pthread_cond_init(&group->done, NULL);
+}
+
+void pool_group_destroy(TaskGroup *group) {
+    pthread_mutex_destroy(&group->lock);
+    pthread_cond_destroy(&group->done);
+}
+
+void pool_wait(Pool *pool, TaskGroup *group) {
+    int self = (tls_pool == pool) ? tls_worker : -1;
+    while (atomic_load(&group->pending) > 0) {
+        Task t;
+        if (find_task(pool, self, 0, &t)) { run_task(&t); continue; }
+        /* las hijas restantes corren en otros hilos: dormir hasta la última */
+        pthread_mutex_lock(&group->lock);
+        while (atomic_load(&group->pending) > 0)
+            pthread_cond_wait(&group->done, &group->lock);
+        pthread_mutex_unlock(&group->lock);
+    }
+    /* la última hija señaliza con el lock tomado: tomarlo aquí espera a que
+     * lo suelte antes de que el llamador destruya el grupo */
+    pthread_mutex_lock(&group->lock);
+    pthread_mutex_unlock(&group->lock);
+}
+
+Pool *pool_current(void) {
+    return tls_pool;
+}
+
+int pool_size(const Pool *pool) {
+    return pool ? pool->n_threads : 1;
+}
+
+void pool_destroy(Pool *pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->sleep_lock);
+    atomic_store(&pool->stop, 1);
+    pthread_cond_broadcast(&pool->sleep_cond);
+    pthread_mutex_unlock(&pool->sleep_lock);
+    for (int i = 0; i < pool->n_started; ++i) pthread_join(pool->threads[i], NULL);
+    for (int i = 0; i < pool->n_threads; ++i) deque_free(&pool->deques[i]);
+    deque_free(&pool->inject);
+    pthread_mutex_destroy(&pool->sleep_lock);
+    pthread_cond_destroy(&pool->sleep_cond);
+    free(pool->deques);
+    free(pool->args);
+    free(pool->threads);
+    free(pool);
+}
@@ -0,0 +1,52 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/* Pool de hilos con planificación por robo de trabajo (work stealing).
+ * Cada hilo tiene su propia deque: las tareas que genera se apilan en ella y
+ * los hilos ociosos roban del otro extremo. Las tareas externas (p. ej. una
+ * petición nueva del bucle de eventos) entran por una cola de inyección. */
+
+typedef void (*TaskFn)(void *arg);
+
+typedef struct Pool Pool;
+
+/* Grupo de tareas hijas que se esperan juntas con pool_wait (fork-join).
+ * Se prepara con pool_group_init y se libera con pool_group_destroy. */
+typedef struct {
+    atomic_long pending;
+    pthread_mutex_t lock;
+    pthread_cond_t done;    /* pending llegó a 0 */
+} TaskGroup;
+
+/* Crea un pool con n_threads hilos (mínimo 1). NULL en error. */
+Pool *pool_create(int n_threads);
+
+/* Encola una tarea independiente. Devuelve 0, o -1 si no hay memoria. */
+int pool_submit(Pool *pool, TaskFn fn, void *arg);
+
+/* Lanza una tarea hija de group: desde un hilo del pool va a su propia deque
+ * (LIFO, buena localidad), si no a la cola de inyección. 0, o -1 sin memoria;
+ * en ese caso la tarea no se lanzó y el llamador debe ejecutarla él mismo. */
+int pool_spawn(Pool *pool, TaskGroup *group, TaskFn fn, void *arg);
+
+void pool_group_init(TaskGroup *group);
+void pool_group_destroy(TaskGroup *group);
+
+/* Espera a que terminen las tareas de group ejecutando tareas pendientes
+ * (propias o robadas) mientras tanto, así un hilo que espera no queda ocioso.
+ * Cuando ya no hay nada que tomar, duerme hasta que termine la última. */
+void pool_wait(Pool *pool, TaskGroup *group);
+
+/* Pool al que pertenece el hilo actual, o NULL si no es un hilo del pool. */
+Pool *pool_current(void);
+
+/* Número de hilos del pool. */
+int pool_size(const Pool *pool);
+
+/* Espera a que terminen las tareas encoladas, detiene los hilos y libera. */
+void pool_destroy(Pool *pool);
+
+#endif
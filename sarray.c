@@ -0,0 +1,433 @@
+/* sarray.c
+ * Arreglo de sufijos de los títulos (ver sarray.h):
+ *  - el texto es cada título (la columna 4 recortada a KEY_SIZE, como la
+ *    clave de index.bin) en minúsculas seguido de SARRAY_SEP, más un 0 final
+ *    que sólo usa la construcción
+ *  - SA-IS (Nong, Zhang y Chan, 2009) ordena todos los sufijos en tiempo
+ *    lineal: clasifica cada posición en S o L, ordena las subcadenas LMS
+ *    induciendo desde ellas, les da nombres y, si se repiten, resuelve
+ *    recursivamente el texto de nombres; los sufijos L y S se inducen a
+ *    partir de los LMS ya ordenados
+ *  - los sufijos que empiezan en un separador quedan primero y no se
+ *    guardan; de los demás se guarda (título, posición) y el LCP con el
+ *    anterior, que se calcula comparando los dos: nunca pasa del separador,
+ *    así cada uno cuesta a lo sumo KEY_SIZE bytes
+ *  - una consulta busca el primer sufijo >= pat y el primero que ya no
+ *    empieza con pat; cada búsqueda binaria arranca la comparación desde lo
+ *    que ya comparten con pat los dos extremos (mlr). El segundo extremo
+ *    suele estar cerca: se mira primero el LCP de los siguientes
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sarray.h"
+#include "index.h"
+#include "util.h"
+
+#define MAX_RECORD_PREFIX 65536 /* el título va antes del abstract */
+#define ALIGN64(x) (((x) + 63) & ~(uint64_t)63)
+#define LCP_SCAN 64             /* sufijos que se miran por LCP antes de buscar */
+#define SORT_ROWS 4096          /* hasta aquí los títulos de un rango se ordenan */
+
+static inline unsigned char fold(unsigned char c) {
+    c = (unsigned char)tolower(c);
+    return c == (unsigned char)SARRAY_SEP ? ' ' : c;
+}
+
+/* --- SA-IS --- */
+
+/* Texto de un nivel: bytes en el primero, nombres (int) en los recursivos. */
+typedef struct {
+    const unsigned char *bytes;
+    const int *ints;
+} Text;
+
+static inline int chr(const Text *s, long i) {
+    return s->bytes ? s->bytes[i] : s->ints[i];
+}
+
+/* Tipo de cada posición (1: S, 0: L), un bit por posición. */
+static inline int is_s(const uint8_t *t, long i) { return (t[i >> 3] >> (i & 7)) & 1; }
+static inline int is_lms(const uint8_t *t, long i) { return i > 0 && is_s(t, i) && !is_s(t, i - 1); }
+
+/* Comienzo (end = 0) o fin (end = 1) del bucket de cada carácter. */
+static void get_buckets(const Text *s, long n, int k, long *bkt, int end) {
+    long sum = 0;
+    memset(bkt, 0, sizeof(long) * (size_t)(k + 1));
+    for (long i = 0; i < n; ++i) bkt[chr(s, i)]++;
+    for (int c = 0; c <= k; ++c) {
+        sum += bkt[c];
+        bkt[c] = end ? sum : sum - bkt[c];
+    }
+}
+
+static void induce(const Text *s, const uint8_t *t, int *sa, long n, int k, long *bkt) {
+    get_buckets(s, n, k, bkt, 0);
+    for (long i = 0; i < n; ++i) {
+        long j = sa[i] - 1;
+        if (sa[i] > 0 && !is_s(t, j)) sa[bkt[chr(s, j)]++] = (int)j;
+    }
+    get_buckets(s, n, k, bkt, 1);
+    for (long i = n - 1; i >= 0; --i) {
+        long j = sa[i] - 1;
+        if (sa[i] > 0 && is_s(t, j)) sa[--bkt[chr(s, j)]] = (int)j;
+    }
+}
+
+/* Ordena los n sufijos de s (caracteres 0..k, con s[n - 1] == 0 único y
+ * mínimo) en sa. 0, o -1 sin memoria. */
+static int sais(const Text *s, int *sa, long n, int k) {
+    uint8_t *t = calloc((size_t)n / 8 + 1, 1);
+    long *bkt = malloc(sizeof(long) * (size_t)(k + 1));
+    if (!t || !bkt) { free(t); free(bkt); return -1; }
+
+    t[(n - 1) >> 3] |= (uint8_t)(1 << ((n - 1) & 7));     /* el 0 final es S */
+    for (long i = n - 2; i >= 0; --i) {
+        int c = chr(s, i), d = chr(s, i + 1);
+        if (c < d || (c == d && is_s(t, i + 1))) t[i >> 3] |= (uint8_t)(1 << (i & 7));
+    }
+
+    /* etapa 1: ordenar las subcadenas LMS */
+    get_buckets(s, n, k, bkt, 1);
+    for (long i = 0; i < n; ++i) sa[i] = -1;
+    for (long i = 1; i < n; ++i)
+        if (is_lms(t, i)) sa[--bkt[chr(s, i)]] = (int)i;
+    induce(s, t, sa, n, k, bkt);
+
+    long n1 = 0;
+    for (long i = 0; i < n; ++i)
+        if (is_lms(t, sa[i])) sa[n1++] = sa[i];
+
+    /* nombres: subcadenas LMS iguales, el mismo; dos LMS nunca están
+     * pegados, así pos / 2 no choca */
+    for (long i = n1; i < n; ++i) sa[i] = -1;
+    int name = 0;
+    long prev = -1;
+    for (long i = 0; i < n1; ++i) {
+        long pos = sa[i];
+        int diff = 0;
+        for (long d = 0; d < n; ++d) {
+            if (prev == -1 || chr(s, pos + d) != chr(s, prev + d) || is_s(t, pos + d) != is_s(t, prev + d)) {
+                diff = 1;
+                break;
+            }
+            if (d > 0 && (is_lms(t, pos + d) || is_lms(t, prev + d))) break;
+        }
+        if (diff) { name++; prev = pos; }
+        sa[n1 + pos / 2] = name - 1;
+    }
+    for (long i = n - 1, j = n - 1; i >= n1; --i)
+        if (sa[i] >= 0) sa[j--] = sa[i];
+
+    /* etapa 2: ordenar los sufijos LMS (recursivo si hay nombres repetidos) */
+    int *sa1 = sa, *s1 = sa + n - n1;
+    int rc = 0;
+    if (name < n1) {
+        Text sub = { NULL, s1 };
+        rc = sais(&sub, sa1, n1, name - 1);
+    } else {
+        for (long i = 0; i < n1; ++i) sa1[s1[i]] = (int)i;
+    }
+
+    /* etapa 3: inducir el orden de todos a partir de los LMS */
+    if (rc == 0) {
+        get_buckets(s, n, k, bkt, 1);
+        for (long i = 1, j = 0; i < n; ++i)
+            if (is_lms(t, i)) s1[j++] = (int)i;
+        for (long i = 0; i < n1; ++i) sa1[i] = s1[sa1[i]];
+        for (long i = n1; i < n; ++i) sa[i] = -1;
+        for (long i = n1 - 1; i >= 0; --i) {
+            int j = sa[i];
+            sa[i] = -1;
+            sa[--bkt[chr(s, j)]] = j;
+        }
+        induce(s, t, sa, n, k, bkt);
+    }
+    free(t);
+    free(bkt);
+    return rc;
+}
+
+/* --- construcción --- */
+
+int sarray_build(const char *csv_path, const char *sa_path) {
+    int fd = open(csv_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { perror(csv_path); return -1; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        fprintf(stderr, "Archivo vacío o ilegible: %s\n", csv_path);
+        close(fd);
+        return -1;
+    }
+    const char *csv = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (csv == MAP_FAILED) { perror("mmap"); return -1; }
+    madvise((void *)csv, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    size_t text_cap = 1 << 20, text_size = 0;
+    unsigned char *text = malloc(text_cap);
+    long rows_cap = 1 << 16, n_rows = 0;
+    SarrayRow *rows = malloc(sizeof(SarrayRow) * (size_t)rows_cap);
+    char *rec = malloc(MAX_RECORD_PREFIX);
+    int *sa = NULL;
+    uint8_t *lcp = NULL;
+    uint32_t *block_row = NULL;
+    FILE *f = NULL;
+    int rc = -1;
+    if (!text || !rows || !rec) { fprintf(stderr, "Sin memoria (arreglo de sufijos)\n"); goto out; }
+
+    const char *p = csv, *end = csv + st.st_size;
+    int header = 1;
+    while (p < end) {
+        size_t len = csv_record_len(p, (size_t)(end - p));
+        if (len == 0) break;
+        size_t copy = len < MAX_RECORD_PREFIX - 1 ? len : MAX_RECORD_PREFIX - 1;
+        memcpy(rec, p, copy);
+        rec[copy] = '\0';
+        uint64_t offset = (uint64_t)(p - csv);
+        p += len;
+        if (header) { header = 0; continue; }
+        char key[KEY_SIZE];
+        if (!csv_get_column(rec, 4, key, sizeof(key)) || key[0] == '\0') continue;
+        size_t key_len = strlen(key);
+        if (n_rows == SARRAY_MAX_ROWS || text_size + key_len + 2 > (size_t)INT32_MAX) {
+            fprintf(stderr, "Demasiados títulos para el arreglo de sufijos\n");
+            goto out;
+        }
+        if (text_size + key_len + 2 > text_cap) {
+            unsigned char *nt = realloc(text, text_cap *= 2);
+            if (!nt) { fprintf(stderr, "Sin memoria (arreglo de sufijos)\n"); goto out; }
+            text = nt;
+        }
+        if (n_rows == rows_cap) {
+            SarrayRow *nr = realloc(rows, sizeof(SarrayRow) * (size_t)(rows_cap *= 2));
+            if (!nr) { fprintf(stderr, "Sin memoria (arreglo de sufijos)\n"); goto out; }
+            rows = nr;
+        }
+        rows[n_rows].csv_offset = offset;
+        rows[n_rows].start = text_size;
+        n_rows++;
+        for (size_t i = 0; i < key_len; ++i) text[text_size++] = fold((unsigned char)key[i]);
+        text[text_size++] = SARRAY_SEP;
+    }
+    text[text_size] = '\0';     /* cabe: se reservaron 2 bytes por título */
+
+    long n = (long)text_size + 1;
+    sa = malloc(sizeof(int) * (size_t)n);
+    if (!sa) { fprintf(stderr, "Sin memoria (arreglo de sufijos)\n"); goto out; }
+    Text s = { text, NULL };
+    if (sais(&s, sa, n, 255) != 0) { fprintf(stderr, "Sin memoria (arreglo de sufijos)\n"); goto out; }
+
+    /* sa[0] es el 0 final y le siguen los n_rows separadores */
+    int *suf = sa + 1 + n_rows;
+    uint64_t n_suffixes = text_size - (uint64_t)n_rows;
+    lcp = malloc(n_suffixes ? n_suffixes : 1);
+    if (!lcp) { fprintf(stderr, "Sin memoria (arreglo de sufijos)\n"); goto out; }
+    for (uint64_t i = 0; i < n_suffixes; ++i) {
+        size_t l = 0;
+        if (i > 0) {
+            const unsigned char *a = text + suf[i - 1], *b = text + suf[i];
+            while (a[l] == b[l] && a[l] != (unsigned char)SARRAY_SEP) l++;
+        }
+        lcp[i] = (uint8_t)(l < 255 ? l : 255);
+    }
+    /* posición -> (fila << 8 | posición dentro del título), en el lugar: la
+     * fila de p es la última con start <= p. block_row da la de cada tramo
+     * de 256 bytes y desde ahí se avanza (pocos títulos por tramo) */
+    size_t n_blocks = text_size / 256 + 1;
+    block_row = malloc(sizeof(uint32_t) * n_blocks);
+    if (!block_row) { fprintf(stderr, "Sin memoria (arreglo de sufijos)\n"); goto out; }
+    for (size_t b = 0, r = 0; b < n_blocks; ++b) {
+        while (r + 1 < (size_t)n_rows && rows[r + 1].start <= b * 256) r++;
+        block_row[b] = (uint32_t)r;
+    }
+    for (uint64_t i = 0; i < n_suffixes; ++i) {
+        uint64_t pos = (uint64_t)suf[i];
+        long r = block_row[pos / 256];
+        while (r + 1 < n_rows && rows[r + 1].start <= pos) r++;
+        suf[i] = (int)(((uint32_t)r << 8) | (uint32_t)(pos - rows[r].start));
+    }
+
+    SarrayHeader hdr = { SARRAY_MAGIC, SARRAY_VERSION, (uint64_t)n_rows, text_size, n_suffixes, 0, 0, 0, 0 };
+    hdr.offset_text = sizeof(SarrayHeader);
+    hdr.offset_sa = ALIGN64(hdr.offset_text + text_size);
+    hdr.offset_lcp = hdr.offset_sa + sizeof(uint32_t) * n_suffixes;
+    hdr.offset_rows = ALIGN64(hdr.offset_lcp + n_suffixes);
+
+    f = fopen(sa_path, "wb");
+    if (!f) { perror(sa_path); goto out; }
+    static const char zero[64];
+    int ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+             fwrite(text, 1, text_size, f) == text_size &&
+             fwrite(zero, 1, hdr.offset_sa - hdr.offset_text - text_size, f) ==
+                 hdr.offset_sa - hdr.offset_text - text_size &&
+             fwrite(suf, sizeof(uint32_t), n_suffixes, f) == n_suffixes &&
+             fwrite(lcp, 1, n_suffixes, f) == n_suffixes &&
+             fwrite(zero, 1, hdr.offset_rows - hdr.offset_lcp - n_suffixes, f) ==
+                 hdr.offset_rows - hdr.offset_lcp - n_suffixes &&
+             fwrite(rows, sizeof(SarrayRow), (size_t)n_rows, f) == (size_t)n_rows;
+    if (fclose(f) != 0 || !ok) {
+        f = NULL;
+        perror("Error escribiendo el arreglo de sufijos");
+        goto out;
+    }
+    f = NULL;
+    printf("Arreglo de sufijos generado: %ld títulos, %llu sufijos, %.1f MB\n", n_rows,
+           (unsigned long long)n_suffixes,
+           (double)(hdr.offset_rows + sizeof(SarrayRow) * (uint64_t)n_rows) / 1e6);
+    rc = 0;
+out:
+    if (f) fclose(f);
+    munmap((void *)csv, (size_t)st.st_size);
+    free(text); free(rows); free(rec); free(sa); free(lcp); free(block_row);
+    return rc;
+}
+
+/* --- consulta --- */
+
+int sarray_open(SarrayMap *m, const char *sa_path) {
+    memset(m, 0, sizeof(*m));
+    int fd = open(sa_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SarrayHeader)) { close(fd); return INDEX_ERR_FORMAT; }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) { perror("mmap"); return -1; }
+    m->base = p;
+    m->size = (size_t)st.st_size;
+    m->header = (const SarrayHeader *)m->base;
+
+    const SarrayHeader *h = m->header;
+    if (h->magic != SARRAY_MAGIC || h->version != SARRAY_VERSION || h->n_rows > SARRAY_MAX_ROWS ||
+        h->n_suffixes + h->n_rows != h->text_size || h->offset_text < sizeof(SarrayHeader) ||
+        h->offset_text + h->text_size > h->offset_sa || h->offset_sa % 64 != 0 ||
+        h->offset_sa + sizeof(uint32_t) * h->n_suffixes > h->offset_lcp ||
+        h->offset_lcp + h->n_suffixes > h->offset_rows || h->offset_rows % 64 != 0 ||
+        h->offset_rows + sizeof(SarrayRow) * h->n_rows > m->size ||
+        (h->text_size && m->base[h->offset_text + h->text_size - 1] != SARRAY_SEP)) {
+        fprintf(stderr, "Arreglo de sufijos con formato antiguo o dañado: %s\n", sa_path);
+        sarray_close(m);
+        return INDEX_ERR_FORMAT;
+    }
+    m->text = (const unsigned char *)(m->base + h->offset_text);
+    m->sa = (const uint32_t *)(m->base + h->offset_sa);
+    m->lcp = (const uint8_t *)(m->base + h->offset_lcp);
+    m->rows = (const SarrayRow *)(m->base + h->offset_rows);
+    return 0;
+}
+
+void sarray_close(SarrayMap *m) {
+    if (m->base) munmap((void *)m->base, m->size);
+    memset(m, 0, sizeof(*m));
+}
+
+/* Compara el sufijo i con pat (len bytes) desde el byte skip, que ya
+ * coincide: < 0 si el sufijo es menor, 0 si empieza con pat, > 0 si es
+ * mayor. En *eq deja cuántos bytes coinciden. */
+static int cmp_suffix(const SarrayMap *m, uint64_t i, const unsigned char *pat, size_t len,
+                      size_t skip, size_t *eq) {
+    uint32_t e = m->sa[i];
+    uint64_t start = m->rows[e >> 8].start + (e & 0xff);
+    const unsigned char *s = m->text + start;
+    size_t left = m->header->text_size - start;  /* el último título termina en SARRAY_SEP */
+    size_t l = skip;
+    while (l < len && l < left && s[l] == pat[l]) l++;
+    *eq = l;
+    if (l == len) return 0;
+    if (l == left) return -1;
+    return s[l] < pat[l] ? -1 : 1;
+}
+
+void sarray_range(const SarrayMap *m, const char *pat_raw, uint64_t *lo_out, uint64_t *hi_out, long *steps) {
+    unsigned char pat[KEY_SIZE];
+    size_t len = 0;
+    *lo_out = *hi_out = 0;
+    *steps = 0;
+    for (; pat_raw[len] && len < sizeof(pat) - 1; ++len) {
+        if (pat_raw[len] == SARRAY_SEP) return;     /* nunca está dentro de un título */
+        pat[len] = (unsigned char)tolower((unsigned char)pat_raw[len]);
+    }
+    uint64_t n = m->header->n_suffixes;
+    if (len == 0 || n == 0) return;
+
+    /* primer sufijo >= pat; lo - 1 comparte llo bytes con pat y hi, lhi */
+    uint64_t lo = 0, hi = n;
+    size_t llo = 0, lhi = 0, eq;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        (*steps)++;
+        if (cmp_suffix(m, mid, pat, len, llo < lhi ? llo : lhi, &eq) < 0) { lo = mid + 1; llo = eq; }
+        else { hi = mid; lhi = eq; }
+    }
+    uint64_t first = lo;
+    if (first == n || cmp_suffix(m, first, pat, len, lhi, &eq) != 0) {
+        *lo_out = *hi_out = first;
+        return;
+    }
+
+    /* primero que ya no empieza con pat: LCP[i] < len (uno por uno unos
+     * pocos, así las consultas con pocos resultados no buscan de nuevo) */
+    uint64_t i = first + 1;
+    for (int k = 0; k < LCP_SCAN && i < n; ++k, ++i)
+        if (m->lcp[i] < len) break;     /* 255 es ">= 255" y len < KEY_SIZE */
+    if (i < n && i - first <= LCP_SCAN) {
+        *steps += (long)(i - first);
+        *lo_out = first;
+        *hi_out = i;
+        return;
+    }
+    lo = i;
+    hi = n;
+    llo = len;
+    lhi = 0;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        (*steps)++;
+        if (cmp_suffix(m, mid, pat, len, llo < lhi ? llo : lhi, &eq) == 0) { lo = mid + 1; llo = eq; }
+        else { hi = mid; lhi = eq; }
+    }
+    *lo_out = first;
+    *hi_out = lo;
+}
+
+static int cmp_row(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+long sarray_rows(const SarrayMap *m, uint64_t lo, uint64_t hi, uint32_t **rows_out) {
+    uint64_t n = hi - lo, n_rows = m->header->n_rows;
+    uint64_t cap = n < n_rows ? n : n_rows;    /* >= los distintos */
+    uint32_t *rows = malloc(sizeof(uint32_t) * (size_t)(cap ? cap : 1));
+    *rows_out = rows;
+    if (!rows) return -1;
+    long distinct = 0;
+    if (n <= SORT_ROWS && n <= cap) {
+        for (uint64_t i = 0; i < n; ++i) rows[i] = sarray_row(m, lo + i);
+        qsort(rows, (size_t)n, sizeof(uint32_t), cmp_row);
+        for (uint64_t i = 0; i < n; ++i)
+            if (distinct == 0 || rows[distinct - 1] != rows[i]) rows[distinct++] = rows[i];
+        return distinct;
+    }
+    /* muchos sufijos: un bit por título y se leen en orden */
+    uint64_t *seen = calloc((size_t)(n_rows / 64 + 1), sizeof(uint64_t));
+    if (!seen) { free(rows); *rows_out = NULL; return -1; }
+    for (uint64_t i = lo; i < hi; ++i) {
+        uint32_t row = sarray_row(m, i);
+        seen[row >> 6] |= (uint64_t)1 << (row & 63);
+    }
+    for (uint64_t w = 0; w <= n_rows / 64; ++w)
+        for (uint64_t bits = seen[w]; bits; bits &= bits - 1)
+            rows[distinct++] = (uint32_t)(w * 64 + (uint64_t)__builtin_ctzll(bits));
+    free(seen);
+    return distinct;
+}
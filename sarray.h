@@ -0,0 +1,75 @@
+#ifndef SARRAY_H
+#define SARRAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Arreglo de sufijos (opcional, -U) sobre los títulos en minúsculas,
+ * concatenados y separados por SARRAY_SEP: las búsquedas por subcadena dejan
+ * de ser una heurística sobre los buckets vecinos y devuelven todos los
+ * títulos que contienen el texto. Los sufijos que empiezan con la consulta
+ * son un rango contiguo del arreglo, que salen de dos búsquedas binarias; el
+ * rango da también cuántos títulos la contienen sin leer el CSV.
+ *
+ * Se construye junto con index.bin en tiempo lineal (SA-IS) y se proyecta
+ * con mmap. Cada entrada del arreglo guarda (título << 8 | posición dentro
+ * del título): los títulos tienen menos de KEY_SIZE bytes, así el sufijo
+ * vuelve a su registro sin buscarlo. Al lado va el LCP de cada sufijo con
+ * el anterior. Como index.mph, es estático y se reconstruye con index.bin. */
+
+#define SARRAY_FILE "index.sa"
+#define SARRAY_MAGIC 0x58415350   /* "PSAX" */
+#define SARRAY_VERSION 1
+#define SARRAY_SEP '\x01'         /* fin de cada título en el texto */
+#define SARRAY_MAX_ROWS (1u << 24)
+
+typedef struct {
+    uint32_t magic;             /* SARRAY_MAGIC */
+    uint32_t version;           /* SARRAY_VERSION */
+    uint64_t n_rows;            /* títulos: uno por registro con título */
+    uint64_t text_size;         /* bytes del texto, separadores incluidos */
+    uint64_t n_suffixes;        /* sufijos que empiezan dentro de un título */
+    uint64_t offset_text;       /* títulos en minúsculas, cada uno con SARRAY_SEP */
+    uint64_t offset_sa;         /* uint32_t[n_suffixes] (fila << 8 | posición), alineado a 64 */
+    uint64_t offset_lcp;        /* uint8_t[n_suffixes]: prefijo común con el sufijo anterior */
+    uint64_t offset_rows;       /* SarrayRow[n_rows], alineado a 64 */
+} SarrayHeader;
+
+typedef struct {
+    uint64_t csv_offset;        /* registro del título */
+    uint64_t start;             /* su primer byte en el texto */
+} SarrayRow;
+
+typedef struct {
+    const char *base;           /* archivo proyectado (sólo lectura) */
+    size_t size;
+    const SarrayHeader *header;
+    const unsigned char *text;
+    const uint32_t *sa;
+    const uint8_t *lcp;
+    const SarrayRow *rows;
+} SarrayMap;
+
+/* Construye sa_path desde el CSV. 0, o -1. */
+int sarray_build(const char *csv_path, const char *sa_path);
+
+/* Proyecta y valida sa_path. 0; -1 si no se pudo abrir; INDEX_ERR_FORMAT
+ * (index.h) si es de otra versión o está dañado. */
+int sarray_open(SarrayMap *m, const char *sa_path);
+void sarray_close(SarrayMap *m);
+
+/* Rango [*lo, *hi) del arreglo con los sufijos que empiezan con pat (se pasa
+ * a minúsculas). En *steps deja los sufijos comparados. */
+void sarray_range(const SarrayMap *m, const char *pat, uint64_t *lo, uint64_t *hi, long *steps);
+
+/* Título del sufijo i del arreglo (índice en rows, en el orden del CSV). */
+static inline uint32_t sarray_row(const SarrayMap *m, uint64_t i) {
+    return m->sa[i] >> 8;
+}
+
+/* Títulos distintos de los sufijos [lo, hi), en orden (el del CSV): deja en
+ * *rows un arreglo nuevo (free) con ellos y devuelve cuántos son, o -1 sin
+ * memoria. */
+long sarray_rows(const SarrayMap *m, uint64_t lo, uint64_t hi, uint32_t **rows);
+
+#endif
@@ -0,0 +1,1240 @@
+/* search.c
+ *
+ * Ejecución de consultas sobre el índice (index.bin) y el CSV.
+ * Búsqueda por SUBCADENA (case-insensitive) en title + filtro opcional update_date (col 12).
+ * El índice y el CSV se leen a través de una proyección mmap de sólo lectura
+ * (IndexMap); las funciones son seguras para llamarse desde varios hilos a la
+ * vez. Abierta antes de fork(), los procesos hijos comparten la proyección.
+ *
+ * Recarga en caliente: cada proyección es una generación con contador de
+ * referencias. Una consulta toma la generación vigente al empezar y la suelta
+ * al terminar; search_reload() construye/proyecta la nueva y la publica con un
+ * intercambio de puntero, y la vieja se desproyecta cuando la suelta su último
+ * lector. Las consultas en curso nunca ven un índice a medio cambiar.
+ *
+ * Desde un hilo del pool, el rango de buckets de una consulta se reparte en
+ * tareas que los demás hilos pueden robar.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>   /* strcasecmp, strncasecmp */
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include "common.h"
+#include "index.h"
+#include "hash.h"
+#include "util.h"
+#include "pool.h"
+#include "search.h"
+#include "stats.h"
+#include "perfctr.h"
+#include "slowlog.h"
+#include "mph.h"
+#include "swiss.h"
+#include "btree.h"
+#include "suggest.h"
+#include "sarray.h"
+
+#define MAX_LINE 8192
+#define MAX_RESULTS 50
+#define BUCKET_RANGE 12    /* heurística: escanear vecinos alrededor del bucket */
+
+static pthread_mutex_t build_lock = PTHREAD_MUTEX_INITIALIZER;
+static SearchOptions options;
+
+/* One mapped generation of index + CSV. */
+typedef struct {
+    IndexMap map;
+    MphMap mph;             /* exact-lookup index (-x); mph.header NULL if none */
+    SwissMap swiss;         /* same with -X; swiss.header NULL if none */
+    Suggest suggest;        /* autocomplete trie (-A); suggest.nodes NULL if none */
+    SarrayMap sarray;       /* substring index (-U); sarray.header NULL if none */
+    atomic_long refs;       /* readers + 1 while it is the current one */
+    struct stat idx_st;     /* index.bin it came from (inode, mtime) */
+    pid_t prefaulted_by;    /* process whose page tables are warm (mlock is per process) */
+} IndexGen;
+
+static pthread_mutex_t gen_lock = PTHREAD_MUTEX_INITIALIZER;  /* swap vs. acquire */
+static IndexGen *current_gen;
+static atomic_int ready;    /* search_warmup finished: queries are served */
+
+void search_configure(const SearchOptions *opts) {
+    options = *opts;
+}
+
+/* Take a reference on the current generation (NULL if none yet). The lock
+ * only covers a pointer read and an increment. */
+static IndexGen *gen_acquire(void) {
+    pthread_mutex_lock(&gen_lock);
+    IndexGen *g = current_gen;
+    if (g) atomic_fetch_add_explicit(&g->refs, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&gen_lock);
+    return g;
+}
+
+/* Drop a reference; the last one unmaps the generation. */
+static void gen_release(IndexGen *g) {
+    if (g && atomic_fetch_sub_explicit(&g->refs, 1, memory_order_acq_rel) == 1) {
+        index_map_close(&g->map);
+        mph_close(&g->mph);
+        swiss_close(&g->swiss);
+        suggest_free(&g->suggest);
+        sarray_close(&g->sarray);
+        free(g);
+    }
+}
+
+static const char *exact_file(void) {
+    return options.exact_index == EXACT_INDEX_SWISS ? SWISS_FILE : MPH_FILE;
+}
+
+/* Build the exact-lookup index the same way. A failure only leaves exact
+ * queries on the chained table. */
+static int build_exact_atomic(void) {
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%d", exact_file(), (int)getpid());
+    int rc = options.exact_index == EXACT_INDEX_SWISS ? swiss_build(CSV_FILE, tmp) : mph_build(CSV_FILE, tmp);
+    if (rc != 0) { unlink(tmp); return -1; }
+    if (rename(tmp, exact_file()) != 0) { perror("rename índice exacto"); unlink(tmp); return -1; }
+    return 0;
+}
+
+/* Same for the suffix array. A failure only leaves substring queries on the
+ * bucket scan. */
+static int build_sarray_atomic(void) {
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%d", SARRAY_FILE, (int)getpid());
+    if (sarray_build(CSV_FILE, tmp) != 0) { unlink(tmp); return -1; }
+    if (rename(tmp, SARRAY_FILE) != 0) { perror("rename arreglo de sufijos"); unlink(tmp); return -1; }
+    return 0;
+}
+
+/* Build into a temporary file and rename it over index_path, so readers (and
+ * other processes) only ever see a complete index. */
+static int build_index_atomic(void) {
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%d", INDEX_FILE, (int)getpid());
+    if (build_index(CSV_FILE, tmp, options.hash_id, options.index_type) != 0) { unlink(tmp); return -1; }
+    if (rename(tmp, INDEX_FILE) != 0) { perror("rename índice"); unlink(tmp); return -1; }
+    if (options.exact_index) build_exact_atomic();
+    if (options.suffix_array) build_sarray_atomic();
+    return 0;
+}
+
+/* Missing file, or CSV modified after it was built. */
+static int file_is_stale(const char *path) {
+    struct stat csv_st, idx_st;
+    if (stat(path, &idx_st) != 0) return 1;
+    if (stat(CSV_FILE, &csv_st) != 0) return 0;   /* map_open reports it */
+    return csv_st.st_mtim.tv_sec > idx_st.st_mtim.tv_sec ||
+           (csv_st.st_mtim.tv_sec == idx_st.st_mtim.tv_sec &&
+            csv_st.st_mtim.tv_nsec > idx_st.st_mtim.tv_nsec);
+}
+
+static int index_is_stale(void) {
+    return file_is_stale(INDEX_FILE);
+}
+
+static int exact_open(IndexGen *g) {
+    return options.exact_index == EXACT_INDEX_SWISS ? swiss_open(&g->swiss, SWISS_FILE)
+                                                    : mph_open(&g->mph, MPH_FILE);
+}
+
+/* Map the exact-lookup index into g, building it first if missing, stale or
+ * in an old format. Without it exact queries walk the chained table. */
+static void gen_open_exact(IndexGen *g) {
+    int rc = file_is_stale(exact_file()) ? INDEX_ERR_FORMAT : exact_open(g);
+    if (rc != 0 && build_exact_atomic() == 0) rc = exact_open(g);
+    if (rc != 0) fprintf(stderr, "Sin índice exacto: las búsquedas exactas usan index.bin\n");
+}
+
+/* Map the suffix array into g the same way. */
+static void gen_open_sarray(IndexGen *g) {
+    int rc = file_is_stale(SARRAY_FILE) ? INDEX_ERR_FORMAT : sarray_open(&g->sarray, SARRAY_FILE);
+    if (rc != 0 && build_sarray_atomic() == 0) rc = sarray_open(&g->sarray, SARRAY_FILE);
+    if (rc != 0) fprintf(stderr, "Sin arreglo de sufijos: las subcadenas usan index.bin\n");
+}
+
+/* Build the autocomplete trie of g from its mapped CSV. It lives only in
+ * memory, so every generation (and every pre-fork worker that reloads)
+ * builds its own. A failure only leaves SUGGEST_TAG and REQ_FUZZY
+ * unsupported. */
+static void gen_build_suggest(IndexGen *g) {
+    long long t0 = now_ns();
+    if (suggest_build(&g->suggest, g->map.csv, g->map.csv_size) != 0) {
+        fprintf(stderr, "Sin autocompletado\n");
+        return;
+    }
+    printf("Autocompletado: %ld títulos, %ld nodos, %.1f MB en %lld ms\n", g->suggest.n_titles,
+           g->suggest.n_nodes,
+           (double)(g->suggest.n_nodes * (long)sizeof(SuggestNode) + (long)g->suggest.labels_size) / 1e6,
+           (now_ns() - t0) / 1000000);
+    fflush(stdout);
+}
+
+/* Map index.bin as a new generation and publish it. Caller holds build_lock.
+ * Returns 0, -1, or INDEX_ERR_FORMAT if the file must be rebuilt. */
+static int gen_publish(void) {
+    IndexGen *g = calloc(1, sizeof(IndexGen));
+    if (!g) return -1;
+    int rc = stat(INDEX_FILE, &g->idx_st) != 0 ? -1 : index_map_open(&g->map, INDEX_FILE, CSV_FILE);
+    if (rc != 0) {
+        free(g);
+        return rc;
+    }
+    if (options.index_type == INDEX_TYPE_BTREE && g->map.header->index_type != INDEX_TYPE_BTREE) {
+        fprintf(stderr, "index.bin no tiene árbol B+\n");
+        index_map_close(&g->map);
+        free(g);
+        return INDEX_ERR_FORMAT;
+    }
+    if (options.exact_index) gen_open_exact(g);
+    if (options.suffix_array) gen_open_sarray(g);
+    if (options.suggest) gen_build_suggest(g);
+    if (options.prefault || options.lock_memory) {
+        index_map_prefault(&g->map, options.lock_memory);
+        g->prefaulted_by = getpid();
+    }
+    atomic_init(&g->refs, 1);   /* the "current" reference */
+
+    pthread_mutex_lock(&gen_lock);
+    IndexGen *old = current_gen;
+    current_gen = g;
+    pthread_mutex_unlock(&gen_lock);
+
+    gen_release(old);   /* unmapped now or when its last query finishes */
+    return 0;
+}
+
+/* Build the index if missing, stale or in an old format, and map it. Only one
+ * thread does it; the rest wait on the lock and then see the finished mapping. */
+int search_open(void) {
+    pthread_mutex_lock(&gen_lock);
+    int mapped = current_gen != NULL;   /* not `ready`: warmup may still be running */
+    pthread_mutex_unlock(&gen_lock);
+    if (mapped) return 0;
+
+    int rc = 0;
+    pthread_mutex_lock(&build_lock);
+    if (!current_gen) {
+        if (index_is_stale()) {
+            printf("Construyendo índice desde %s...\n", CSV_FILE);
+            fflush(stdout);
+            rc = build_index_atomic();
+        }
+        if (rc == 0) rc = gen_publish();
+        if (rc == INDEX_ERR_FORMAT) rc = build_index_atomic() == 0 ? gen_publish() : -1;
+        if (rc != 0) rc = -1;
+    }
+    pthread_mutex_unlock(&build_lock);
+    return rc;
+}
+
+int search_build(void) {
+    pthread_mutex_lock(&build_lock);
+    int rc = build_index_atomic();
+    pthread_mutex_unlock(&build_lock);
+    return rc;
+}
+
+int search_reload(void) {
+    int rc = 0;
+    pthread_mutex_lock(&build_lock);
+
+    struct stat idx_st;
+    if (access(CSV_FILE, R_OK) != 0) {
+        perror(CSV_FILE);
+        pthread_mutex_unlock(&build_lock);
+        return -1;
+    }
+    /* CSV newer than the index (or no index): build a new one first */
+    if (index_is_stale()) {
+        printf("Recarga: construyendo un índice nuevo desde %s...\n", CSV_FILE);
+        fflush(stdout);
+        if (build_index_atomic() != 0) rc = -1;
+    }
+    if (rc == 0 && stat(INDEX_FILE, &idx_st) != 0) rc = -1;
+
+    if (rc == 0) {
+        /* a new file (ours or built offline) replaces the current generation */
+        IndexGen *cur = current_gen;
+        if (cur && cur->idx_st.st_ino == idx_st.st_ino && cur->idx_st.st_dev == idx_st.st_dev &&
+            cur->idx_st.st_mtim.tv_sec == idx_st.st_mtim.tv_sec &&
+            cur->idx_st.st_mtim.tv_nsec == idx_st.st_mtim.tv_nsec) {
+            printf("Recarga: el índice ya está al día.\n");
+        } else if ((rc = gen_publish()) == INDEX_ERR_FORMAT) {
+            fprintf(stderr, "Recarga: index.bin tiene otro formato; se ignora\n");
+            rc = -1;
+        } else if (rc != 0) {
+            rc = -1;
+        } else {
+            printf("Recarga: índice nuevo en servicio.\n");
+        }
+    }
+    fflush(stdout);
+    pthread_mutex_unlock(&build_lock);
+    return rc;
+}
+
+/* Work done for one query, for the slow-query log. In a batch, a CSV record
+ * read once counts for the query that read it. */
+typedef struct {
+    unsigned long buckets;  /* buckets walked for it */
+    unsigned long entries;  /* EntryDisk compared with its title */
+    unsigned long matches;  /* keys containing the title (candidates) */
+    unsigned long reads;    /* CSV records read */
+    unsigned long bytes;    /* bytes of those records */
+} ScanCounts;
+
+/* Output of one query within one scan task: matching CSV records appended into
+ * buf (capacity sz; allocated on first match when owned by a task). */
+typedef struct {
+    char *buf;
+    size_t sz;
+    size_t used;
+    int found;
+    int done;               /* MAX_RESULTS reached or buffer full */
+    int clipped;            /* last record cut: alone it did not fit in buf */
+    atomic_int pub_found;   /* found/used as seen by the other tasks */
+    atomic_size_t pub_used;
+    ScanCounts cnt;
+} Sink;
+
+/* How a query matches titles (Request.flags). */
+enum { MATCH_SUBSTRING, MATCH_EXACT, MATCH_PREFIX, MATCH_RANGE, MATCH_FUZZY };
+static const char *const match_names[] = { "substring", "exact", "prefix", "range", "fuzzy" };
+
+/* One pending query of a (possibly batched) request. */
+typedef struct {
+    char title[KEY_SIZE];
+    char update[64];        /* "" if no update_date filter */
+    unsigned long h;        /* home bucket of title */
+    int range;              /* buckets walked on each side of h */
+    int match;              /* MATCH_* */
+    const char *via;        /* "mph"/"swiss"/"btree"/"trie"/"sarray": answered
+                             * by that index, not by the bucket scan */
+    int unsupported;        /* prefix/range query and no B+ tree to answer it,
+                             * fuzzy query and no title trie, or count and no
+                             * suffix array */
+    char norm[KEY_SIZE];    /* hash_normalize(title), unless MATCH_SUBSTRING */
+    char upper[KEY_SIZE];   /* MATCH_RANGE: normalized end (excluded), "" = none */
+    int max_edits;          /* MATCH_FUZZY: edit distance bound */
+    int count;              /* REQ_COUNT: answer how many titles, not records */
+    Sink out;               /* final destination (Response.result) */
+    long long deadline_ns;  /* now_ns() limit, 0 = none */
+    atomic_int timed_out;   /* some task hit the deadline: results are partial */
+    int timing;             /* stats_timing_wanted: measure the stages */
+    atomic_llong stage_ns[N_STAGES];
+    unsigned long long hw[N_HW];    /* perf counter deltas of its scan (-H) */
+    ScanCounts cnt;         /* summed over the scan tasks */
+    long n_tasks;           /* scan tasks it ran in (1: sequential) */
+} Query;
+
+/* Scan task number t: buckets [lo, hi] for every query. Results of query i go
+ * to sinks[t * n + i]; sinks holds the sinks of every task of the search. */
+typedef struct {
+    const IndexMap *map;
+    Query *qs;
+    Sink *sinks;
+    int n;
+    long t;
+    long lo, hi;
+    int rc;
+    int timing;             /* some query measures its stages */
+    long long walk_ns;      /* task time outside match/fetch/filter */
+    unsigned long long hw[N_HW];    /* perf counter deltas of the task */
+} ScanTask;
+
+#define MIN_BUCKETS_PER_TASK 2
+#define DEADLINE_CHECK_EVERY 64   /* entries between clock reads */
+#define TASKS_PER_THREAD 4
+
+/* Query i stops in task t once its own sink is done or once tasks 0..t
+ * together already fill MAX_RESULTS or the response: results merge in task
+ * order, so nothing task t finds from then on would be kept. Earlier tasks
+ * only ever add results, which keeps the output equal to a sequential walk. */
+static int query_stopped(const ScanTask *st, int i) {
+    Sink *own = &st->sinks[st->t * st->n + i];
+    if (own->done) return 1;
+    if (atomic_load_explicit(&st->qs[i].timed_out, memory_order_relaxed)) {
+        own->done = 1;
+        return 1;
+    }
+    int found = 0;
+    size_t used = 0;
+    for (long u = 0; u < st->t; ++u) {
+        Sink *s = &st->sinks[u * st->n + i];
+        found += atomic_load_explicit(&s->pub_found, memory_order_relaxed);
+        used += atomic_load_explicit(&s->pub_used, memory_order_relaxed);
+    }
+    if (found + own->found >= MAX_RESULTS || used + own->used + 1 >= own->sz) {
+        own->done = 1;
+        return 1;
+    }
+    return 0;
+}
+
+/* Append one CSV record to the sink if space permits. */
+static void sink_append(Sink *s, const char *line) {
+    size_t line_len = strnlen(line, MAX_LINE);
+    int clip = 0;
+    if (s->used + line_len + 1 >= s->sz) {
+        /* not enough space left; stop collecting. A record larger
+         * than the whole response goes out cut instead of "NA". */
+        if (s->used > 0) { s->done = 1; return; }
+        line_len = s->sz - 2;
+        clip = 1;
+    }
+    if (!s->buf && !(s->buf = malloc(s->sz))) { s->done = 1; return; }
+    memcpy(s->buf + s->used, line, line_len);
+    s->used += line_len;
+    if (clip) { s->buf[s->used - 1] = '\n'; s->clipped = 1; s->done = 1; }
+    s->buf[s->used] = '\0';
+    s->found++;
+    if (s->found >= MAX_RESULTS) s->done = 1;
+    atomic_store_explicit(&s->pub_found, s->found, memory_order_relaxed);
+    atomic_store_explicit(&s->pub_used, s->used, memory_order_relaxed);
+}
+
+/* Mark every query whose deadline is <= now as timed out. */
+static void expire_queries(const ScanTask *st, long long now) {
+    for (int i = 0; i < st->n; ++i)
+        if (st->qs[i].deadline_ns && now >= st->qs[i].deadline_ns)
+            atomic_store_explicit(&st->qs[i].timed_out, 1, memory_order_relaxed);
+}
+
+/* Add the time since *t0 to stage s of q and to *work; *t0 moves to now. */
+static void stage_lap(Query *q, int s, long long *t0, long long *work) {
+    long long t1 = now_ns();
+    atomic_fetch_add_explicit(&q->stage_ns[s], t1 - *t0, memory_order_relaxed);
+    *work += t1 - *t0;
+    *t0 = t1;
+}
+
+/* Walk buckets [lo, hi] of the index using substring match for title, for n
+ * queries at once. Buckets are visited in ascending order and each chain is
+ * walked a single time for all the queries whose range covers it; a CSV line
+ * matched by several queries is read only once. Returns 0, or -1 on error.
+ */
+static int scan_buckets(ScanTask *st) {
+    Query *qs = st->qs;
+    Sink *sinks = &st->sinks[st->t * st->n];
+    int n = st->n;
+    const IndexMap *m = st->map;
+    int *active = malloc(sizeof(int) * (size_t)n);
+    if (!active) return -1;
+
+    char linebuf[MAX_LINE];
+    long long nearest = 0;   /* earliest deadline among the queries */
+    for (int i = 0; i < n; ++i)
+        if (qs[i].deadline_ns && (!nearest || qs[i].deadline_ns < nearest)) nearest = qs[i].deadline_ns;
+    unsigned ticks = 0;
+    long long task_start = st->timing ? now_ns() : 0;
+    long long work = 0;     /* match/fetch/filter time of timed queries */
+    /* counters kept local and published once per task */
+    unsigned long n_entries = 0, n_matches = 0, n_reads = 0, n_bytes = 0, n_reuse = 0;
+    /* hardware counters of the thread running this task, read around it */
+    int hw_on = perfctr_enabled();
+    if (hw_on) perfctr_read(st->hw);
+
+    for (long bucket_idx = st->lo; bucket_idx <= st->hi; ++bucket_idx) {
+        /* queries whose range covers this bucket and still want results */
+        int n_active = 0;
+        for (int i = 0; i < n; ++i) {
+            long d = bucket_idx - (long)qs[i].h;
+            if (d >= -qs[i].range && d <= qs[i].range && !query_stopped(st, i)) {
+                active[n_active++] = i;
+                sinks[i].cnt.buckets++;
+            }
+        }
+        if (n_active == 0) continue;
+
+        long current = m->buckets[bucket_idx].first_entry_offset;
+
+        while (current != -1 && n_active > 0) {
+            /* cooperative deadline check: expired queries stop, flagged partial */
+            if (nearest && ++ticks % DEADLINE_CHECK_EVERY == 0 && now_ns() >= nearest) {
+                expire_queries(st, now_ns());
+                int k = 0;
+                for (int a = 0; a < n_active; ++a)
+                    if (!query_stopped(st, active[a])) active[k++] = active[a];
+                n_active = k;
+                if (n_active == 0) break;
+            }
+            const EntryDisk *entry = index_map_entry(m, current);
+            if (!entry) break;
+            n_entries++;
+
+            int line_state = 0; /* 0: not read yet, 1: in linebuf, -1: unreadable */
+            for (int a = 0; a < n_active; ++a) {
+                Query *q = &qs[active[a]];
+                Sink *s = &sinks[active[a]];
+                if (s->done) continue;
+                s->cnt.entries++;
+
+                /* substring match (case-insensitive), or equal normalized keys */
+                long long t0 = q->timing ? now_ns() : 0;
+                int hit;
+                if (q->match == MATCH_EXACT) {
+                    char norm[KEY_SIZE];
+                    hash_normalize(entry->key, norm, sizeof(norm));
+                    hit = strcmp(norm, q->norm) == 0;
+                } else {
+                    hit = ci_strcasestr(entry->key, q->title) != NULL;
+                }
+                if (q->timing) stage_lap(q, STAGE_MATCH, &t0, &work);
+                if (!hit) continue;
+                n_matches++;
+                s->cnt.matches++;
+
+                /* read CSV line at offset (once per entry) */
+                if (line_state == 0) {
+                    long got = index_map_csv_line(m, entry->csv_offset, linebuf, sizeof(linebuf));
+                    line_state = got > 0 ? 1 : -1;
+                    if (got > 0) {
+                        n_reads++;
+                        n_bytes += (unsigned long)got;
+                        s->cnt.reads++;
+                        s->cnt.bytes += (unsigned long)got;
+                    }
+                    if (q->timing) stage_lap(q, STAGE_FETCH, &t0, &work);
+                } else if (line_state == 1) {
+                    n_reuse++;
+                }
+                if (line_state != 1) continue;
+                /* the CSV fetch is the slow part: re-check right after it */
+                if (q->deadline_ns && now_ns() >= q->deadline_ns) {
+                    atomic_store_explicit(&q->timed_out, 1, memory_order_relaxed);
+                    s->done = 1;
+                    continue;
+                }
+
+                if (q->update[0] != '\0') {
+                    char parsed_update[64];
+                    if (q->timing) t0 = now_ns();
+                    int keep = csv_get_column(linebuf, 12, parsed_update, sizeof(parsed_update)) &&
+                               strcasecmp(parsed_update, q->update) == 0;
+                    if (q->timing) stage_lap(q, STAGE_FILTER, &t0, &work);
+                    if (!keep) continue;
+                }
+
+                sink_append(s, linebuf);
+            }
+
+            /* drop finished queries from the active set */
+            int k = 0;
+            for (int a = 0; a < n_active; ++a)
+                if (!sinks[active[a]].done) active[k++] = active[a];
+            n_active = k;
+
+            current = entry->next_entry;
+        } /* while entries */
+    } /* for buckets */
+
+    if (st->timing) st->walk_ns = now_ns() - task_start - work;
+    if (hw_on) {
+        unsigned long long end[N_HW];
+        perfctr_read(end);
+        for (int k = 0; k < N_HW; ++k) st->hw[k] = end[k] - st->hw[k];
+    }
+    stats_add(STAT_ENTRIES, n_entries);
+    stats_add(STAT_MATCHES, n_matches);
+    stats_add(STAT_CSV_READS, n_reads);
+    stats_add(STAT_CSV_BYTES, n_bytes);
+    stats_add(STAT_FETCH_REUSE, n_reuse);
+    free(active);
+    return 0;
+}
+
+static void scan_task_run(void *arg) {
+    ScanTask *t = arg;
+    t->rc = scan_buckets(t);
+}
+
+/* Append the lines of src to dst while MAX_RESULTS and the buffer allow. */
+static void sink_merge(Sink *dst, const Sink *src) {
+    const char *p = src->buf;
+    const char *end = src->buf + src->used;
+    while (p < end && !dst->done) {
+        /* one CSV record, which may span several lines */
+        size_t len = csv_record_len(p, (size_t)(end - p));
+        if (dst->used + len + 1 >= dst->sz) { dst->done = 1; break; }
+        memcpy(dst->buf + dst->used, p, len);
+        dst->used += len;
+        dst->buf[dst->used] = '\0';
+        if (++dst->found >= MAX_RESULTS) dst->done = 1;
+        p += len;
+        if (p == end && src->clipped) { dst->clipped = 1; dst->done = 1; }
+    }
+}
+
+/* The chain walk is shared by the queries of a batch: each one gets the
+ * whole walk time and hardware counter deltas, summed over the tasks that
+ * ran it, plus its own counts from its sinks (sinks[t * n + i]). The
+ * daemon-wide counters get the deltas once. */
+static void add_task_totals(Query *qs, int n, const ScanTask *tasks, long n_tasks, const Sink *sinks) {
+    long long walk_ns = 0;
+    unsigned long long hw[N_HW] = { 0 };
+    for (long t = 0; t < n_tasks; ++t) {
+        walk_ns += tasks[t].walk_ns;
+        for (int k = 0; k < N_HW; ++k) hw[k] += tasks[t].hw[k];
+    }
+    for (int i = 0; i < n; ++i) {
+        if (qs[i].via) continue;
+        if (qs[i].timing) atomic_fetch_add_explicit(&qs[i].stage_ns[STAGE_WALK], walk_ns, memory_order_relaxed);
+        memcpy(qs[i].hw, hw, sizeof(hw));
+        qs[i].n_tasks = n_tasks;
+        for (long t = 0; t < n_tasks; ++t) {
+            const ScanCounts *c = &sinks[t * n + i].cnt;
+            qs[i].cnt.buckets += c->buckets;
+            qs[i].cnt.entries += c->entries;
+            qs[i].cnt.matches += c->matches;
+            qs[i].cnt.reads += c->reads;
+            qs[i].cnt.bytes += c->bytes;
+        }
+    }
+    if (perfctr_enabled()) stats_add_hw(hw);
+}
+
+/* Read the CSV record at offset for q and append it unless confirm finds
+ * another title (an exact-index candidate) or update_date filters it out.
+ * Returns 0, or -1 once the deadline passed. */
+static int emit_record(const IndexMap *m, Query *q, long offset, int confirm,
+                       long long *t0, long long *work) {
+    if (q->deadline_ns && now_ns() >= q->deadline_ns) {
+        atomic_store_explicit(&q->timed_out, 1, memory_order_relaxed);
+        return -1;
+    }
+    char linebuf[MAX_LINE];
+    long got = index_map_csv_line(m, offset, linebuf, sizeof(linebuf));
+    if (got <= 0) return 0;
+    q->cnt.reads++;
+    q->cnt.bytes += (unsigned long)got;
+    stats_add(STAT_CSV_READS, 1);
+    stats_add(STAT_CSV_BYTES, (unsigned long)got);
+    char key[KEY_SIZE], norm[KEY_SIZE];
+    int same = !confirm || csv_get_column(linebuf, 4, key, sizeof(key));
+    if (same && confirm) {
+        hash_normalize(key, norm, sizeof(norm));
+        same = strcmp(norm, q->norm) == 0;
+    }
+    if (q->timing) stage_lap(q, STAGE_FETCH, t0, work);
+    if (!same) return 0;
+    q->cnt.matches++;
+    stats_add(STAT_MATCHES, 1);
+
+    if (q->update[0] != '\0') {
+        char parsed_update[64];
+        int keep = csv_get_column(linebuf, 12, parsed_update, sizeof(parsed_update)) &&
+                   strcasecmp(parsed_update, q->update) == 0;
+        if (q->timing) stage_lap(q, STAGE_FILTER, t0, work);
+        if (!keep) return 0;
+    }
+    sink_append(&q->out, linebuf);
+    return 0;
+}
+
+/* Exact query answered by the exact-lookup index. index.mph gives one slot
+ * whose records are read to confirm their normalized title (the 32-bit
+ * fingerprint can let an absent title through); index.swt compares the
+ * stored title, so only real matches are read. Both then apply the
+ * update_date filter. */
+static void exact_query(const IndexGen *g, Query *q) {
+    const IndexMap *m = &g->map;
+    long long t0 = q->timing ? now_ns() : 0, work = 0;
+    uint64_t single, few[MAX_RESULTS], *many = NULL;
+    const uint64_t *offsets = NULL;
+    long n;
+    int confirm = 0;
+    if (g->swiss.header) {
+        long groups;
+        n = swiss_lookup(&g->swiss, q->norm, few, MAX_RESULTS, &groups);
+        offsets = few;
+        if (n > MAX_RESULTS) {
+            /* the update_date filter may reject the first ones */
+            if ((many = malloc(sizeof(uint64_t) * (size_t)n))) {
+                swiss_lookup(&g->swiss, q->norm, many, n, &groups);
+                offsets = many;
+            } else {
+                n = MAX_RESULTS;
+            }
+        }
+        q->via = "swiss";
+        q->cnt.buckets = (unsigned long)groups;
+        stats_add(STAT_SWISS_LOOKUPS, 1);
+        stats_add(STAT_SWISS_GROUPS, (unsigned long)groups);
+    } else {
+        n = mph_lookup(&g->mph, q->norm, &offsets, &single);
+        confirm = 1;
+        q->via = "mph";
+        stats_add(STAT_MPH_LOOKUPS, 1);
+    }
+    if (q->timing) stage_lap(q, STAGE_MATCH, &t0, &work);
+
+    for (long k = 0; k < n && !q->out.done; ++k)
+        if (emit_record(m, q, (long)offsets[k], confirm, &t0, &work) != 0) break;
+    free(many);
+}
+
+/* Ordered query answered by the B+ tree: from the first title >= norm, in
+ * title order, while titles stay equal to norm (exact), start with it
+ * (prefix) or sort before upper (range). */
+static void tree_query(const IndexGen *g, Query *q) {
+    long long t0 = q->timing ? now_ns() : 0, work = 0;
+    size_t len = strlen(q->norm);
+    BtreeCursor c;
+    q->via = "btree";
+    stats_add(STAT_BTREE_SCANS, 1);
+    if (btree_seek(&c, &g->map, q->norm) == 0) {
+        if (q->timing) stage_lap(q, STAGE_WALK, &t0, &work);
+        while (!q->out.done && btree_next(&c)) {
+            int in = q->match == MATCH_EXACT ? strcmp(c.key, q->norm) == 0
+                   : q->match == MATCH_PREFIX ? strncmp(c.key, q->norm, len) == 0
+                   : q->upper[0] == '\0' || strcmp(c.key, q->upper) < 0;
+            q->cnt.entries++;
+            if (q->timing) stage_lap(q, STAGE_MATCH, &t0, &work);
+            if (!in) break;
+            if (emit_record(&g->map, q, c.csv_offset, 0, &t0, &work) != 0) break;
+        }
+    }
+    q->cnt.buckets = (unsigned long)c.pages;
+    stats_add(STAT_BTREE_PAGES, (unsigned long)c.pages);
+}
+
+/* Fuzzy query answered by the title trie: every record of the closest
+ * titles (by edit distance, then weight), then the update_date filter. */
+static void fuzzy_query(const IndexGen *g, Query *q) {
+    long long t0 = q->timing ? now_ns() : 0, work = 0;
+    const Suggest *s = &g->suggest;
+    SuggestMatch found[MAX_RESULTS];
+    long visited;
+    int n = suggest_fuzzy(s, q->norm, q->max_edits, found, MAX_RESULTS, &visited);
+    q->via = "trie";
+    q->cnt.entries = (unsigned long)visited;
+    stats_add(STAT_FUZZY, 1);
+    stats_add(STAT_FUZZY_NODES, (unsigned long)visited);
+    if (q->timing) stage_lap(q, STAGE_MATCH, &t0, &work);
+
+    for (int i = 0; i < n && !q->out.done; ++i) {
+        const SuggestNode *nd = &s->nodes[found[i].node];
+        for (uint32_t r = 0; r < nd->n_records && !q->out.done; ++r)
+            if (emit_record(&g->map, q, (long)s->records[nd->record + r], 0, &t0, &work) != 0) return;
+    }
+}
+
+/* Substring query answered by the suffix array: every title containing the
+ * value (not only those in the neighbor buckets), in CSV order, or with
+ * REQ_COUNT just how many, without reading the CSV. */
+static void sarray_query(const IndexGen *g, Query *q) {
+    long long t0 = q->timing ? now_ns() : 0, work = 0;
+    const SarrayMap *sm = &g->sarray;
+    uint64_t lo, hi;
+    long steps;
+    sarray_range(sm, q->title, &lo, &hi, &steps);
+    q->via = "sarray";
+    q->cnt.entries = (unsigned long)steps;
+    stats_add(STAT_SA_QUERIES, 1);
+    stats_add(STAT_SA_STEPS, (unsigned long)steps);
+    if (lo == hi) return;
+    uint32_t *rows;
+    long n = sarray_rows(sm, lo, hi, &rows);
+    if (q->timing) stage_lap(q, STAGE_MATCH, &t0, &work);
+    if (n < 0) return;
+
+    if (q->count) {
+        char line[96];
+        snprintf(line, sizeof(line), "COUNT titles=%ld occurrences=%llu\n", n, (unsigned long long)(hi - lo));
+        sink_append(&q->out, line);
+    } else {
+        for (long i = 0; i < n && !q->out.done; ++i)
+            if (emit_record(&g->map, q, (long)sm->rows[rows[i]].csv_offset, 0, &t0, &work) != 0) break;
+    }
+    free(rows);
+}
+
+/* Run n queries over the union of their neighbor ranges. Inside a pool
+ * thread, the range is split into tasks of contiguous buckets that idle
+ * threads can steal; task results are merged in bucket order, so the output
+ * matches the sequential walk unless MAX_RESULTS/the response cut it short.
+ * Returns 0, or -1 on error.
+ */
+static int run_queries(const IndexGen *g, Query *qs, int n) {
+    const IndexMap *m = &g->map;
+    long n_buckets = m->header->n_buckets;
+    int timing = 0;
+
+    /* union of the neighbor ranges of every query */
+    long lo = n_buckets, hi = -1;
+    for (int i = 0; i < n; ++i) {
+        qs[i].out.used = 0;
+        qs[i].out.found = 0;
+        qs[i].out.done = 0;
+        qs[i].out.clipped = 0;
+        qs[i].out.buf[0] = '\0';
+        if (qs[i].match == MATCH_FUZZY) {
+            if (g->suggest.nodes) {
+                fuzzy_query(g, &qs[i]);
+            } else {
+                qs[i].unsupported = 1;
+                qs[i].via = "none";
+            }
+            qs[i].range = -1;
+            continue;
+        }
+        if (qs[i].match == MATCH_SUBSTRING && g->sarray.header) {
+            sarray_query(g, &qs[i]);
+            qs[i].range = -1;
+            continue;
+        }
+        if (qs[i].count) {
+            /* without the suffix array counting means reading every title */
+            qs[i].unsupported = 1;
+            qs[i].via = "none";
+            qs[i].range = -1;
+            continue;
+        }
+        if (qs[i].match == MATCH_EXACT && (g->mph.header || g->swiss.header)) {
+            /* a probe or two; range -1 keeps it out of the scan */
+            exact_query(g, &qs[i]);
+            qs[i].range = -1;
+            continue;
+        }
+        if (qs[i].match != MATCH_SUBSTRING && m->header->index_type == INDEX_TYPE_BTREE) {
+            tree_query(g, &qs[i]);
+            qs[i].range = -1;
+            continue;
+        }
+        if (qs[i].match == MATCH_PREFIX || qs[i].match == MATCH_RANGE) {
+            /* buckets hold no order: nothing to scan */
+            qs[i].unsupported = 1;
+            qs[i].via = "none";
+            qs[i].range = -1;
+            continue;
+        }
+        timing |= qs[i].timing;
+        qs[i].h = hash_key(m->header->hash_id, qs[i].title) % (unsigned long)n_buckets;
+        if ((long)qs[i].h - qs[i].range < lo) lo = (long)qs[i].h - qs[i].range;
+        if ((long)qs[i].h + qs[i].range > hi) hi = (long)qs[i].h + qs[i].range;
+    }
+    if (hi < 0) return 0;   /* every query was answered without the scan */
+    if (lo < 0) lo = 0;
+    if (hi >= n_buckets) hi = n_buckets - 1;
+
+    Pool *pool = pool_current();
+    long span = hi - lo + 1;
+    long n_tasks = (long)pool_size(pool) * TASKS_PER_THREAD;
+    if (n_tasks > span / MIN_BUCKETS_PER_TASK) n_tasks = span / MIN_BUCKETS_PER_TASK;
+
+    if (!pool || pool_size(pool) <= 1 || n_tasks <= 1) {
+        /* sequential: a single task writing straight into the responses */
+        Sink *sinks = malloc(sizeof(Sink) * (size_t)n);
+        if (!sinks) return -1;
+        for (int i = 0; i < n; ++i) sinks[i] = qs[i].out;
+        ScanTask st = { .map = m, .qs = qs, .sinks = sinks, .n = n, .t = 0, .lo = lo, .hi = hi,
+                        .timing = timing };
+        int rc = scan_buckets(&st);
+        for (int i = 0; i < n; ++i) qs[i].out = sinks[i];
+        add_task_totals(qs, n, &st, 1, sinks);
+        free(sinks);
+        return rc;
+    }
+
+    ScanTask *tasks = calloc((size_t)n_tasks, sizeof(ScanTask));
+    Sink *sinks = calloc((size_t)(n_tasks * n), sizeof(Sink));
+    if (!tasks || !sinks) { free(tasks); free(sinks); return -1; }
+
+    TaskGroup group;
+    pool_group_init(&group);
+    for (long t = 0; t < n_tasks; ++t) {
+        ScanTask *st = &tasks[t];
+        st->map = m;
+        st->qs = qs;
+        st->n = n;
+        st->t = t;
+        st->sinks = sinks;
+        st->lo = lo + span * t / n_tasks;
+        st->hi = lo + span * (t + 1) / n_tasks - 1;
+        st->timing = timing;
+        for (int i = 0; i < n; ++i) sinks[t * n + i].sz = qs[i].out.sz;
+        if (pool_spawn(pool, &group, scan_task_run, st) != 0) scan_task_run(st);
+    }
+    pool_wait(pool, &group);
+    pool_group_destroy(&group);
+
+    int rc = 0;
+    add_task_totals(qs, n, tasks, n_tasks, sinks);
+    for (long t = 0; t < n_tasks; ++t) {
+        if (tasks[t].rc != 0) rc = -1;
+        for (int i = 0; i < n; ++i) {
+            Sink *s = &sinks[t * n + i];
+            if (s->buf) sink_merge(&qs[i].out, s);
+            free(s->buf);
+        }
+    }
+    free(tasks);
+    free(sinks);
+    return rc;
+}
+
+/* Run n queries on the current index generation, which stays mapped until
+ * they finish even if a reload swaps in a new one meanwhile. */
+static int search_queries(Query *qs, int n) {
+    if (!qs || n <= 0) return -1;
+    long long t0 = now_ns();
+    if (search_open() != 0) return -1;
+    IndexGen *g = gen_acquire();
+    if (!g) return -1;
+    long long open_ns = now_ns() - t0;
+    for (int i = 0; i < n; ++i)
+        if (qs[i].timing) atomic_store_explicit(&qs[i].stage_ns[STAGE_OPEN], open_ns, memory_order_relaxed);
+    int rc = run_queries(g, qs, n);
+    gen_release(g);
+    return rc;
+}
+
+int search_warmup(void) {
+    if (search_open() != 0) return -1;
+    /* a generation published before options were set (pre-fork parent)
+     * is prefaulted/locked here, in the process that will use it */
+    IndexGen *g = gen_acquire();
+    if (!g) return -1;
+    if ((options.prefault || options.lock_memory) && g->prefaulted_by != getpid()) {
+        index_map_prefault(&g->map, options.lock_memory);
+        g->prefaulted_by = getpid();
+    }
+    gen_release(g);
+    atomic_store(&ready, 1);
+    return 0;
+}
+
+int search_ready(void) {
+    return atomic_load(&ready);
+}
+
+/* Answer a STATUS_TAG request. */
+static void status_response(Response *res) {
+    IndexGen *g = atomic_load(&ready) ? gen_acquire() : NULL;
+    if (!g) {
+        snprintf(res->result, sizeof(res->result), "LOADING\n");
+        res->flags |= RES_LOADING;
+        return;
+    }
+    snprintf(res->result, sizeof(res->result),
+             "READY buckets=%d entries=%ld hash=%s index_bytes=%zu csv_bytes=%zu\n",
+             g->map.header->n_buckets, g->map.header->n_entries, hash_name(g->map.header->hash_id),
+             g->map.idx_size, g->map.csv_size);
+    if (g->map.header->index_type == INDEX_TYPE_BTREE) {
+        size_t len = strlen(res->result) - 1;
+        snprintf(res->result + len, sizeof(res->result) - len, " btree_pages=%ld btree_height=%d\n",
+                 g->map.header->btree_pages, g->map.header->btree_height);
+    }
+    if (g->mph.header) {
+        size_t len = strlen(res->result) - 1;   /* over the '\n' */
+        snprintf(res->result + len, sizeof(res->result) - len, " mph_keys=%llu mph_bytes=%zu\n",
+                 (unsigned long long)g->mph.header->n_keys, g->mph.size);
+    }
+    if (g->swiss.header) {
+        size_t len = strlen(res->result) - 1;
+        snprintf(res->result + len, sizeof(res->result) - len, " swiss_keys=%llu swiss_groups=%llu swiss_bytes=%zu\n",
+                 (unsigned long long)g->swiss.header->n_keys, (unsigned long long)g->swiss.header->n_groups,
+                 g->swiss.size);
+    }
+    if (g->sarray.header) {
+        size_t len = strlen(res->result) - 1;
+        snprintf(res->result + len, sizeof(res->result) - len, " sa_suffixes=%llu sa_bytes=%zu\n",
+                 (unsigned long long)g->sarray.header->n_suffixes, g->sarray.size);
+    }
+    if (g->suggest.nodes) {
+        size_t len = strlen(res->result) - 1;
+        snprintf(res->result + len, sizeof(res->result) - len, " suggest_titles=%ld suggest_nodes=%ld\n",
+                 g->suggest.n_titles, g->suggest.n_nodes);
+    }
+    gen_release(g);
+}
+
+/* Answer a SUGGEST_TAG request: the top-k titles under the prefix, printed
+ * as they appear in the CSV (the trie only holds normalized ones). */
+static void suggest_response(const Request *req, Response *res) {
+    IndexGen *g = atomic_load(&ready) ? gen_acquire() : NULL;
+    if (!g) {
+        snprintf(res->result, sizeof(res->result), "LOADING");
+        res->flags |= RES_LOADING;
+        stats_add(STAT_LOADING, 1);
+        return;
+    }
+    if (!g->suggest.nodes) {
+        snprintf(res->result, sizeof(res->result), "UNSUPPORTED");
+        res->flags |= RES_UNSUPPORTED;
+        stats_add(STAT_UNSUPPORTED, 1);
+        gen_release(g);
+        return;
+    }
+    int k = req->value2[0] ? atoi(req->value2) : SUGGEST_K;
+    uint64_t offsets[SUGGEST_MAX_K];
+    uint32_t weights[SUGGEST_MAX_K];
+    int found = suggest_top(&g->suggest, req->value1, k, offsets, weights);
+    Sink out = { .buf = res->result, .sz = sizeof(res->result) };
+    for (int i = 0; i < found; ++i) {
+        char line[MAX_LINE], title[KEY_SIZE + 1];
+        if (index_map_csv_line(&g->map, (long)offsets[i], line, sizeof(line)) < 0) continue;
+        if (!csv_get_column(line, 4, title, KEY_SIZE)) continue;
+        size_t len = strlen(title);
+        title[len] = '\n';
+        title[len + 1] = '\0';
+        sink_append(&out, title);
+    }
+    if (out.found == 0) snprintf(res->result, sizeof(res->result), "NA");
+    stats_add(STAT_SUGGESTS, 1);
+    gen_release(g);
+}
+
+void search_evict(Response *res) {
+    IndexGen *g = atomic_load(&ready) ? gen_acquire() : NULL;
+    if (!g) {
+        snprintf(res->result, sizeof(res->result), "LOADING\n");
+        res->flags |= RES_LOADING;
+        return;
+    }
+    size_t resident = 0;
+    int rc = index_map_evict(&g->map, INDEX_FILE, CSV_FILE, &resident);
+    snprintf(res->result, sizeof(res->result),
+             "%s resident_bytes=%zu index_bytes=%zu csv_bytes=%zu\n",
+             rc == 0 ? "EVICTED" : "EVICT_FAILED", resident, g->map.idx_size, g->map.csv_size);
+    gen_release(g);
+}
+
+/* Extract title and update_date values (supports either field position) */
+static void parse_request(const Request *req, char *title_val, size_t title_sz,
+                          char *update_val, size_t update_sz) {
+    title_val[0] = '\0';
+    update_val[0] = '\0';
+
+    if (field_is(req->field_name1, "title")) {
+        strncpy(title_val, req->value1, title_sz-1);
+        title_val[title_sz-1] = '\0';
+        trim_inplace(title_val);
+    } else if (field_is(req->field_name2, "title")) {
+        strncpy(title_val, req->value2, title_sz-1);
+        title_val[title_sz-1] = '\0';
+        trim_inplace(title_val);
+    }
+
+    if (field_is(req->field_name1, "update_date") || field_is(req->field_name1, "updatedate") || field_is(req->field_name1, "update-date")) {
+        strncpy(update_val, req->value1, update_sz-1);
+        update_val[update_sz-1] = '\0';
+        trim_inplace(update_val);
+    } else if (field_is(req->field_name2, "update_date") || field_is(req->field_name2, "updatedate") || field_is(req->field_name2, "update-date")) {
+        strncpy(update_val, req->value2, update_sz-1);
+        update_val[update_sz-1] = '\0';
+        trim_inplace(update_val);
+    }
+}
+
+/* Trimmed value of the field called name (in either slot) into out, or "". */
+static void request_field(const Request *req, const char *name, char *out, size_t sz) {
+    const char *v = field_is(req->field_name1, name) ? req->value1
+                  : field_is(req->field_name2, name) ? req->value2 : "";
+    strncpy(out, v, sz - 1);
+    out[sz - 1] = '\0';
+    trim_inplace(out);
+}
+
+/* Append "s" to buf with quotes, backslashes and control characters escaped,
+ * so a slow-log entry stays on one line. */
+static void append_quoted(char *buf, size_t sz, size_t *len, const char *s) {
+    if (*len + 1 >= sz) return;
+    buf[(*len)++] = '"';
+    for (; *s && *len + 4 < sz; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') { buf[(*len)++] = '\\'; buf[(*len)++] = (char)c; }
+        else if (c < 0x20) *len += (size_t)snprintf(buf + *len, sz - *len, "\\x%02x", c);
+        else buf[(*len)++] = (char)c;
+    }
+    buf[(*len)++] = '"';
+    buf[*len] = '\0';
+}
+
+/* One slow-log line for query q, number i of a message of n that took
+ * total_ns from arrival (exec_ns of them running). */
+static void log_slow_query(const Request *req, const Query *q, const Response *res,
+                           int i, int n, long long total_ns, long long exec_ns) {
+    char line[4096];
+    size_t len = 0;
+    char when[32];
+    time_t t = time(NULL);
+    struct tm tm;
+    strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S", localtime_r(&t, &tm));
+
+#define LOG(...) do { \
+        int w_ = snprintf(line + len, sizeof(line) - len, __VA_ARGS__); \
+        if (w_ > 0) len += (size_t)w_; \
+        if (len >= sizeof(line)) len = sizeof(line) - 1; \
+    } while (0)
+
+    LOG("%s pid=%d total_us=%lld exec_us=%lld query=%d/%d", when, (int)getpid(),
+        total_ns / 1000, exec_ns / 1000, i + 1, n);
+    LOG(" %s=", req->field_name1[0] ? req->field_name1 : "field1");
+    append_quoted(line, sizeof(line), &len, req->value1);
+    if (req->field_name2[0]) {
+        LOG(" %s=", req->field_name2);
+        append_quoted(line, sizeof(line), &len, req->value2);
+    }
+    LOG(" timeout_ms=%d match=%s path=%s tasks=%ld", req->timeout_ms, match_names[q->match],
+        q->via ? q->via : q->n_tasks > 1 ? "parallel" : "sequential", q->n_tasks);
+    if (n > 1) LOG(" batch=%d", n);
+    LOG(" buckets=%lu entries=%lu candidates=%lu csv_reads=%lu csv_bytes=%lu results=%d%s",
+        q->cnt.buckets, q->cnt.entries, q->cnt.matches, q->cnt.reads, q->cnt.bytes,
+        q->out.found, (res->flags & RES_TRUNCATED) ? " truncated" : "");
+    for (int s = 0; s < STAGE_WRITE; ++s)
+        LOG(" %s_us=%lld", stage_names[s],
+            atomic_load_explicit(&q->stage_ns[s], memory_order_relaxed) / 1000);
+    if (perfctr_enabled()) {
+        int avail = perfctr_available();
+        for (int k = 0; k < N_HW; ++k)
+            if (avail & (1 << k)) LOG(" %s=%llu", hw_names[k], q->hw[k]);
+    }
+#undef LOG
+    line[len++] = '\n';
+    slowlog_write(line, len);
+}
+
+/* Resolve n requests (n == 1 for a plain request) into n responses.
+ * Requests without a title get "NA" without touching the index. With the
+ * slow-query log on, every query is timed by stage and the message is logged
+ * if it ends past the threshold.
+ */
+void handle_requests(const Request *reqs, Response *res, int n, long long arrival_ns) {
+    long long exec_start = now_ns();
+    Query *qs = calloc((size_t)n, sizeof(Query));
+    int *slot = calloc((size_t)n, sizeof(int));
+    if (!qs || !slot) {
+        for (int i = 0; i < n; ++i) strncpy(res[i].result, "NA", sizeof(res[i].result)-1);
+        free(qs); free(slot);
+        return;
+    }
+
+    int loading = !atomic_load(&ready);
+    int nq = 0;
+    for (int i = 0; i < n; ++i) {
+        memset(&res[i], 0, sizeof(res[i]));
+        if (field_is(reqs[i].field_name1, STATUS_TAG)) { status_response(&res[i]); slot[i] = -2; continue; }
+        if (field_is(reqs[i].field_name1, EVICT_TAG)) { search_evict(&res[i]); slot[i] = -2; continue; }
+        if (field_is(reqs[i].field_name1, SUGGEST_TAG)) { suggest_response(&reqs[i], &res[i]); slot[i] = -2; continue; }
+        if (field_is(reqs[i].field_name1, STATS_TAG)) {
+            stats_format(res[i].result, sizeof(res[i].result));
+            slot[i] = -2;
+            continue;
+        }
+        if (loading) {
+            /* index still being built at startup: answer now, don't block */
+            strncpy(res[i].result, "LOADING", sizeof(res[i].result)-1);
+            res[i].flags |= RES_LOADING;
+            stats_add(STAT_LOADING, 1);
+            slot[i] = -2;
+            continue;
+        }
+        qs[nq].timing = stats_timing_wanted(&reqs[i]) || slowlog_enabled();
+        long long t0 = qs[nq].timing ? now_ns() : 0;
+        parse_request(&reqs[i], qs[nq].title, sizeof(qs[nq].title),
+                      qs[nq].update, sizeof(qs[nq].update));
+        if (qs[nq].timing) atomic_store_explicit(&qs[nq].stage_ns[STAGE_PARSE], now_ns() - t0, memory_order_relaxed);
+        /* If no title provided -> UI expects NA */
+        if (qs[nq].title[0] == '\0') { slot[i] = -1; continue; }
+        /* exact lookups only need the bucket of the normalized title */
+        int flags = reqs[i].flags;
+        qs[nq].match = flags & REQ_FUZZY ? MATCH_FUZZY : flags & REQ_RANGE ? MATCH_RANGE
+                     : flags & REQ_PREFIX ? MATCH_PREFIX : flags & REQ_EXACT ? MATCH_EXACT
+                     : MATCH_SUBSTRING;
+        qs[nq].range = qs[nq].match == MATCH_SUBSTRING ? BUCKET_RANGE : 0;
+        if (qs[nq].match != MATCH_SUBSTRING) hash_normalize(qs[nq].title, qs[nq].norm, sizeof(qs[nq].norm));
+        if (qs[nq].match == MATCH_RANGE) {
+            char to[KEY_SIZE];
+            request_field(&reqs[i], "title_to", to, sizeof(to));
+            hash_normalize(to, qs[nq].upper, sizeof(qs[nq].upper));
+        }
+        if (qs[nq].match == MATCH_FUZZY) {
+            char edits[16];
+            request_field(&reqs[i], "max_edits", edits, sizeof(edits));
+            qs[nq].max_edits = edits[0] ? atoi(edits) : FUZZY_K;
+        }
+        qs[nq].count = qs[nq].match == MATCH_SUBSTRING && (flags & REQ_COUNT);
+        if (qs[nq].count) qs[nq].update[0] = '\0';
+        qs[nq].out.buf = res[i].result;
+        qs[nq].out.sz = sizeof(res[i].result);
+        int timeout_ms = reqs[i].timeout_ms > 0 ? reqs[i].timeout_ms : options.default_timeout_ms;
+        if (timeout_ms > 0) qs[nq].deadline_ns = arrival_ns + (long long)timeout_ms * 1000000LL;
+        slot[i] = nq++;
+    }
+
+    int rc = nq > 0 ? search_queries(qs, nq) : 0;
+    stats_add(STAT_QUERIES, (unsigned long)nq);
+    if (n > 1) stats_add(STAT_BATCHES, 1);
+    if (rc != 0) stats_add(STAT_ERRORS, 1);
+
+    for (int i = 0; i < n; ++i) {
+        if (slot[i] == -2) continue;   /* status / loading, already answered */
+        if (slot[i] >= 0 && rc == 0 &&
+            (atomic_load(&qs[slot[i]].timed_out) || qs[slot[i]].out.clipped)) {
+            res[i].flags |= RES_TRUNCATED;
+            stats_add(STAT_TRUNCATED, 1);
+        }
+        if (slot[i] >= 0 && rc == 0 && qs[slot[i]].unsupported) {
+            strncpy(res[i].result, "UNSUPPORTED", sizeof(res[i].result)-1);
+            res[i].flags |= RES_UNSUPPORTED;
+            stats_add(STAT_UNSUPPORTED, 1);
+            continue;
+        }
+        if (slot[i] < 0 || rc != 0 || qs[slot[i]].out.found <= 0) {
+            stats_add(STAT_NA, 1);
+            memset(res[i].result, 0, sizeof(res[i].result));
+            strncpy(res[i].result, "NA", sizeof(res[i].result)-1);
+        }
+        if (slot[i] >= 0 && stats_timing_wanted(&reqs[i])) {
+            /* STAGE_WRITE is recorded by the server once the response is out */
+            for (int s = 0; s < STAGE_WRITE; ++s) {
+                long long ns = atomic_load_explicit(&qs[slot[i]].stage_ns[s], memory_order_relaxed);
+                stats_record(s, ns);
+                if (reqs[i].flags & REQ_TIMING) res[i].stage_us[s] = (int)(ns / 1000);
+            }
+        }
+    }
+
+    long long done_ns = now_ns();
+    if (nq > 0 && slowlog_is_slow(done_ns - arrival_ns)) {
+        stats_add(STAT_SLOW, 1);
+        for (int i = 0; i < n; ++i)
+            if (slot[i] >= 0)
+                log_slow_query(&reqs[i], &qs[slot[i]], &res[i], i, n,
+                               done_ns - arrival_ns, done_ns - exec_start);
+    }
+
+    free(qs);
+    free(slot);
+}
+
+/* Size in bytes of the message starting at buf (len bytes available):
+ * sizeof(Request) for a plain request, (1 + N) * sizeof(Request) for a batch.
+ * Returns 0 if more bytes are needed to know, -1 if the header is invalid.
+ * *batch_out tells a batch apart from a plain request even when N == 1. */
+long request_message_size(const void *buf, size_t len, int *n_out, int *batch_out) {
+    if (len < sizeof(Request)) return 0;
+    const Request *hdr = (const Request *)buf;
+    int n = 1;
+    int batch = field_is(hdr->field_name1, BATCH_TAG);
+    long total = (long)sizeof(Request);
+    if (batch) {
+        n = atoi(hdr->value1);
+        if (n <= 0 || n > MAX_BATCH) return -1;
+        total = (long)sizeof(Request) * (n + 1);
+    }
+    if (n_out) *n_out = n;
+    if (batch_out) *batch_out = batch;
+    return total;
+}
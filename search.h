@@ -0,0 +1,69 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stddef.h>
+#include "common.h"
+
+#define CSV_FILE "arxiv.csv"
+#define INDEX_FILE "index.bin"
+
+/* Opciones del motor de búsqueda fijadas al arrancar el daemon. */
+typedef struct {
+    int default_timeout_ms;   /* plazo de las Request con timeout_ms == 0 (0: sin plazo) */
+    int prefault;             /* precargar las páginas del índice al proyectarlo */
+    int lock_memory;          /* además fijarlas en RAM con mlock */
+    int hash_id;              /* HASH_* de los índices que se construyan */
+    int exact_index;          /* EXACT_INDEX_*: índice para las REQ_EXACT */
+    int index_type;           /* INDEX_TYPE_* (index.h) de los índices que se construyan */
+    int suggest;              /* armar el trie de autocompletado (suggest.h, -A) */
+    int suffix_array;         /* subcadenas con index.sa (sarray.h, -U) */
+} SearchOptions;
+
+enum {
+    EXACT_INDEX_NONE,         /* recorrer el bucket de index.bin */
+    EXACT_INDEX_MPH,          /* index.mph (mph.h, -x) */
+    EXACT_INDEX_SWISS         /* index.swt (swiss.h, -X) */
+};
+
+void search_configure(const SearchOptions *opts);
+
+/* Construye el índice si falta y lo proyecta en memoria junto con el CSV.
+ * Las consultas lo llaman solas la primera vez; llamarlo antes de fork()
+ * hace que todos los procesos compartan la misma proyección. 0, o -1. */
+int search_open(void);
+
+/* Arranque: search_open más la precarga/mlock pedidas en las opciones.
+ * Hasta que termina, las consultas se responden al instante con
+ * RES_LOADING ("LOADING") y una Request STATUS_TAG informa el estado. */
+int search_warmup(void);
+
+/* 1 si search_warmup terminó y se atienden consultas. */
+int search_ready(void);
+
+/* Recarga en caliente: si el CSV es más reciente que el índice (o no hay
+ * índice) construye uno nuevo en segundo plano respecto de las consultas;
+ * si index.bin cambió (p. ej. construido offline con -B) lo proyecta. La
+ * nueva generación se publica de forma atómica; la anterior se desproyecta
+ * cuando termina su última consulta. 0, o -1 (se sigue con la anterior). */
+int search_reload(void);
+
+/* Atiende EVICT_TAG: desaloja de la caché de páginas el índice y el CSV de
+ * la generación vigente y escribe el resultado en res. */
+void search_evict(Response *res);
+
+/* Construye index.bin desde el CSV (vía archivo temporal + rename). */
+int search_build(void);
+
+/* Resuelve n Request (n == 1 para una consulta normal; el cuerpo de un lote
+ * para n > 1) en n Response. Las consultas sin título reciben "NA".
+ * arrival_ns (now_ns() al recibir el mensaje) es el origen de los plazos; si
+ * una consulta agota el suyo, devuelve lo encontrado con RES_TRUNCATED. */
+void handle_requests(const Request *reqs, Response *res, int n, long long arrival_ns);
+
+/* Tamaño del mensaje que empieza en buf: sizeof(Request) para una consulta
+ * normal o (1 + N) * sizeof(Request) para un lote. Devuelve 0 si faltan bytes
+ * para saberlo y -1 si la cabecera es inválida; en n_out deja N (1 si no es
+ * lote) y en batch_out si trae cabecera de lote, aunque N sea 1. */
+long request_message_size(const void *buf, size_t len, int *n_out, int *batch_out);
+
+#endif
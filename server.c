@@ -0,0 +1,599 @@
+/* server.c
+ *
+ * Bucle de eventos del daemon basado en epoll (level-triggered).
+ *  - Socket UNIX (SOCK_STREAM): muchas conexiones, cada una con sus buffers de
+ *    entrada/salida. Una conexión inactiva sólo cuesta su struct Conn.
+ *  - FIFO_REQ/FIFO_RES: protocolo original de la UI. FIFO_REQ se abre en modo
+ *    no bloqueante (más un escritor propio para no recibir EOF entre clientes)
+ *    y FIFO_RES se abre con O_NONBLOCK reintentando con un timerfd mientras la
+ *    UI todavía no lo abrió; un lector lento ya no detiene al daemon.
+ * Los mensajes completos (Request o lote) se ejecutan en el pool; al terminar,
+ * el trabajador encola el Job en done_head y despierta al bucle con un eventfd.
+ * Cada conexión tiene como mucho una petición en curso: no se lee la siguiente
+ * hasta haber enviado la respuesta anterior, así el orden se conserva.
+ * SIGHUP (vía signalfd, bloqueada en todos los hilos) lanza search_reload en
+ * un hilo aparte: la recarga del índice no detiene el bucle ni las consultas.
+ * SIGUSR1 (también por signalfd) vuelca las métricas (stats.c) en stderr.
+ * Control de admisión: si ya hay max_queue peticiones esperando un hilo, la
+ * nueva se responde al instante con RES_BUSY en vez de encolarse; así la
+ * saturación es visible para el cliente y la latencia queda acotada.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <signal.h>
+
+#include "common.h"
+#include "search.h"
+#include "server.h"
+#include "stats.h"
+#include "util.h"
+
+#define MAX_EVENTS 64
+#define READ_CHUNK 4096
+#define FIFO_RETRY_NS 1000000L    /* reintento de open(FIFO_RES): 1 ms */
+#define FIFO_GIVEUP_SEC 10        /* se descarta la respuesta si nadie la lee */
+
+enum { EV_LISTEN, EV_SOCKET, EV_FIFO_IN, EV_FIFO_OUT, EV_WAKE, EV_TIMER, EV_SIGNAL };
+
+typedef struct Conn {
+    int kind;
+    int fd;                 /* -1 si ya se cerró */
+    uint32_t mask;          /* eventos registrados en epoll */
+    char *in;               /* mensaje en construcción */
+    size_t in_len, in_cap;
+    char *out;              /* respuesta pendiente de enviar */
+    size_t out_len, out_off;
+    int busy;               /* hay un Job en el pool para esta conexión */
+    long long out_start_ns; /* respuesta medida: cuándo se entregó a out (STAGE_WRITE) */
+    struct Conn *next_dead; /* en dead_head, esperando a conn_reap */
+} Conn;
+
+typedef struct Job {
+    Conn *conn;
+    int n;
+    Request *reqs;
+    Response *res;
+    long long arrival_ns;   /* now_ns() al completar el mensaje */
+    int timed;              /* alguna consulta mide sus etapas */
+    struct Job *next;
+} Job;
+
+static int epfd = -1;
+static Pool *workers;
+static int max_queue;
+static atomic_int queued;     /* Jobs enviados al pool que aún no empezaron */
+
+static pthread_mutex_t done_lock = PTHREAD_MUTEX_INITIALIZER;
+static Job *done_head;
+
+static Conn *dead_head;       /* conexiones cerradas durante el lote de epoll */
+
+static Conn listen_conn = { .kind = EV_LISTEN, .fd = -1 };
+static Conn wake_conn   = { .kind = EV_WAKE,   .fd = -1 };
+static Conn timer_conn  = { .kind = EV_TIMER,  .fd = -1 };
+static Conn signal_conn = { .kind = EV_SIGNAL, .fd = -1 };
+static atomic_int reloading;  /* hay un hilo de recarga en curso */
+static Conn fifo_in     = { .kind = EV_FIFO_IN,  .fd = -1 };
+static Conn fifo_out    = { .kind = EV_FIFO_OUT, .fd = -1 };
+static int fifo_keep_fd = -1;         /* escritor propio de FIFO_REQ */
+static struct timespec fifo_deadline; /* límite para entregar por FIFO_RES */
+
+static int try_dispatch(Conn *c);
+static void server_job_run(void *arg);
+static void job_finish(Job *job);
+
+/* --- epoll helpers --- */
+
+static int watch_add(Conn *c, uint32_t mask) {
+    struct epoll_event ev = { .events = mask, .data.ptr = c };
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &ev) != 0) return -1;
+    c->mask = mask;
+    return 0;
+}
+
+/* Recalcula el interés de la conexión: leer sólo si está ociosa, escribir
+ * sólo si queda salida pendiente. */
+static void watch_update(Conn *c) {
+    if (c->fd < 0) return;
+    uint32_t mask = 0;
+    if (c->kind == EV_SOCKET || c->kind == EV_FIFO_IN) {
+        if (!c->busy && c->out_off == c->out_len) mask |= EPOLLIN;
+    }
+    if (c->out_off < c->out_len) mask |= EPOLLOUT;
+    if (mask == c->mask) return;
+    struct epoll_event ev = { .events = mask, .data.ptr = c };
+    if (epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev) == 0) c->mask = mask;
+}
+
+static void timer_arm(long ns) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_nsec = ns;
+    timerfd_settime(timer_conn.fd, 0, &its, NULL);
+}
+
+/* --- conexiones --- */
+
+/* La liberación se difiere hasta terminar el lote de epoll_wait: un evento
+ * posterior del mismo lote puede apuntar todavía a esta conexión. */
+static void conn_free(Conn *c) {
+    c->next_dead = dead_head;
+    dead_head = c;
+}
+
+static void conn_reap(void) {
+    while (dead_head) {
+        Conn *c = dead_head;
+        dead_head = c->next_dead;
+        free(c->in);
+        free(c->out);
+        free(c);
+    }
+}
+
+static void conn_close(Conn *c) {
+    if (c->fd >= 0) {
+        epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+        close(c->fd);
+        c->fd = -1;
+    }
+    /* con un Job en curso, la liberación queda para cuando termine */
+    if (!c->busy) conn_free(c);
+}
+
+/* Escribe lo que se pueda de c->out. 1 si quedó todo enviado, 0 si falta
+ * (EAGAIN), -1 en error. */
+static int flush_out(Conn *c) {
+    while (c->out_off < c->out_len) {
+        ssize_t w;
+        if (c->kind == EV_SOCKET)
+            w = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL);
+        else
+            w = write(c->fd, c->out + c->out_off, c->out_len - c->out_off);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        c->out_off += (size_t)w;
+    }
+    if (c->out_start_ns) {
+        stats_record(STAGE_WRITE, now_ns() - c->out_start_ns);
+        c->out_start_ns = 0;
+    }
+    free(c->out);
+    c->out = NULL;
+    c->out_len = c->out_off = 0;
+    return 1;
+}
+
+/* La respuesta por FIFO terminó (entregada o descartada): FIFO_REQ vuelve a
+ * aceptar la siguiente petición. */
+static void fifo_out_done(void) {
+    if (fifo_out.fd >= 0) {
+        epoll_ctl(epfd, EPOLL_CTL_DEL, fifo_out.fd, NULL);
+        close(fifo_out.fd);
+        fifo_out.fd = -1;
+    }
+    free(fifo_out.out);
+    fifo_out.out = NULL;
+    fifo_out.out_len = fifo_out.out_off = 0;
+    fifo_out.out_start_ns = 0;
+    fifo_in.busy = 0;
+    try_dispatch(&fifo_in);
+    watch_update(&fifo_in);
+}
+
+static void fifo_out_flush(void) {
+    int r = flush_out(&fifo_out);
+    if (r != 0) fifo_out_done();   /* completo, o el lector se fue */
+    else watch_update(&fifo_out);
+}
+
+/* Intenta abrir FIFO_RES sin bloquear; si la UI aún no lo abrió (ENXIO) se
+ * reintenta con el timer hasta FIFO_GIVEUP_SEC. */
+static void fifo_out_open(void) {
+    int fd = open(FIFO_RES, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT && mkfifo(FIFO_RES, 0666) == -1 && errno != EEXIST)
+            perror("mkfifo FIFO_RES");
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > fifo_deadline.tv_sec ||
+            (now.tv_sec == fifo_deadline.tv_sec && now.tv_nsec >= fifo_deadline.tv_nsec)) {
+            fprintf(stderr, "FIFO_RES: nadie leyó la respuesta, se descarta\n");
+            fifo_out_done();
+            return;
+        }
+        timer_arm(FIFO_RETRY_NS);
+        return;
+    }
+    fifo_out.fd = fd;
+    fifo_out.mask = 0;
+    if (watch_add(&fifo_out, 0) != 0) { fifo_out_done(); return; }
+    fifo_out_flush();
+}
+
+/* Responde "BUSY" (RES_BUSY) a todas las consultas de job sin ejecutarlas.
+ * Devuelve lo mismo que try_dispatch. */
+static int reply_busy(Job *job) {
+    Conn *c = job->conn;
+    int n = job->n;
+    stats_add(STAT_BUSY, (unsigned long)n);
+    for (int i = 0; i < n; ++i) {
+        strncpy(job->res[i].result, "BUSY", sizeof(job->res[i].result)-1);
+        job->res[i].flags = RES_BUSY;
+    }
+    if (c->kind == EV_FIFO_IN) { job_finish(job); return 0; }
+    c->busy = 0;
+    c->out = (char *)job->res;
+    c->out_len = sizeof(Response) * (size_t)n;
+    c->out_off = 0;
+    free(job->reqs);
+    free(job);
+    if (flush_out(c) < 0) { conn_close(c); return -1; }
+    return 0;
+}
+
+/* Si c->in contiene un mensaje completo, lo despacha al pool. Devuelve -1 si
+ * la conexión se cerró (y ya no debe usarse), 0 en otro caso. */
+static int try_dispatch(Conn *c) {
+    if (c->busy || c->out_off < c->out_len) return 0;
+    int n = 1, batch = 0;
+    long need = request_message_size(c->in, c->in_len, &n, &batch);
+    if (need < 0) {
+        /* cabecera inválida: se cierra el socket; en el FIFO se descarta lo leído */
+        stats_add(STAT_ERRORS, 1);
+        if (c->kind == EV_SOCKET) { conn_close(c); return -1; }
+        c->in_len = 0;
+        return 0;
+    }
+    if (need == 0 || c->in_len < (size_t)need) return 0;
+
+    Job *job = calloc(1, sizeof(Job));
+    if (job) {
+        job->conn = c;
+        job->n = n;
+        job->reqs = malloc(sizeof(Request) * (size_t)n);
+        job->res = calloc((size_t)n, sizeof(Response));
+    }
+    if (!job || !job->reqs || !job->res) {
+        /* sin memoria ni para responder: con el mensaje ya completo en el
+         * buffer no llegaría otro evento que lo reintente, así que se cierra
+         * el socket; en el FIFO se descarta, como una cabecera inválida */
+        if (job) { free(job->reqs); free(job->res); free(job); }
+        stats_add(STAT_ERRORS, 1);
+        if (c->kind == EV_SOCKET) { conn_close(c); return -1; }
+        memmove(c->in, c->in + need, c->in_len - (size_t)need);
+        c->in_len -= (size_t)need;
+        return 0;
+    }
+    size_t body = batch ? sizeof(Request) : 0;   /* saltar cabecera de lote */
+    memcpy(job->reqs, c->in + body, sizeof(Request) * (size_t)n);
+    if (batch) {
+        /* el plazo de la cabecera vale para las consultas que no traen uno;
+         * sus flags, para todas */
+        const Request *hdr = (const Request *)c->in;
+        for (int i = 0; i < n; ++i) {
+            if (job->reqs[i].timeout_ms <= 0) job->reqs[i].timeout_ms = hdr->timeout_ms;
+            job->reqs[i].flags |= hdr->flags;
+        }
+    }
+    for (int i = 0; i < n; ++i) job->timed |= stats_timing_wanted(&job->reqs[i]);
+    job->arrival_ns = now_ns();
+    memmove(c->in, c->in + need, c->in_len - (size_t)need);
+    c->in_len -= (size_t)need;
+
+    c->busy = 1;
+
+    if (max_queue > 0 && atomic_load(&queued) >= max_queue)
+        return reply_busy(job);   /* cola llena: sin pasar por el pool */
+
+    atomic_fetch_add(&queued, 1);
+    if (pool_submit(workers, server_job_run, job) != 0) {
+        /* el mensaje ya salió de c->in: hay que contestarlo igual */
+        atomic_fetch_sub(&queued, 1);
+        return reply_busy(job);
+    }
+    return 0;
+}
+
+/* Lee del descriptor mientras la conexión esté ociosa y haya datos. */
+static void conn_read(Conn *c) {
+    while (!c->busy && c->out_off == c->out_len) {
+        if (try_dispatch(c) < 0) return;
+        if (c->busy || c->out_off < c->out_len) break;
+        if (c->in_cap - c->in_len < READ_CHUNK) {
+            size_t cap = c->in_cap ? c->in_cap * 2 : READ_CHUNK * 2;
+            char *p = realloc(c->in, cap);
+            if (!p) break;
+            c->in = p;
+            c->in_cap = cap;
+        }
+        ssize_t r = read(c->fd, c->in + c->in_len, c->in_cap - c->in_len);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (c->kind == EV_SOCKET) { conn_close(c); return; }
+            break;
+        }
+        if (r == 0) {
+            /* el cliente cerró; FIFO_REQ nunca llega a EOF (fifo_keep_fd) */
+            if (c->kind == EV_SOCKET) { conn_close(c); return; }
+            break;
+        }
+        c->in_len += (size_t)r;
+    }
+    /* libera el buffer de las conexiones que quedaron sin datos pendientes */
+    if (c->in_len == 0 && c->in_cap > READ_CHUNK * 2) {
+        free(c->in);
+        c->in = NULL;
+        c->in_cap = 0;
+    }
+    watch_update(c);
+}
+
+/* Ejecutado por un hilo del pool. */
+static void server_job_run(void *arg) {
+    Job *job = arg;
+    atomic_fetch_sub(&queued, 1);
+
+    long long start = now_ns();
+    handle_requests(job->reqs, job->res, job->n, job->arrival_ns);
+    long long end = now_ns();
+    for (int i = 0; i < job->n; ++i) {
+        job->res[i].queue_us = (int)((start - job->arrival_ns) / 1000);
+        job->res[i].exec_us = (int)((end - start) / 1000);
+    }
+    stats_add(STAT_REQUESTS, 1);
+    stats_record_latency(end - job->arrival_ns);
+
+    pthread_mutex_lock(&done_lock);
+    job->next = done_head;
+    done_head = job;
+    pthread_mutex_unlock(&done_lock);
+
+    uint64_t one = 1;
+    ssize_t w = write(wake_conn.fd, &one, sizeof(one));
+    (void)w;
+}
+
+/* Entrega la respuesta de un Job terminado a su conexión. */
+static void job_finish(Job *job) {
+    Conn *c = job->conn;
+    c->busy = 0;
+    free(job->reqs);
+
+    if (c->kind == EV_SOCKET && c->fd < 0) {
+        /* el cliente se fue mientras se buscaba */
+        conn_free(c);
+        free(job->res);
+        free(job);
+        return;
+    }
+
+    Conn *dst = c->kind == EV_FIFO_IN ? &fifo_out : c;
+    dst->out = (char *)job->res;
+    dst->out_len = sizeof(Response) * (size_t)job->n;
+    dst->out_off = 0;
+    dst->out_start_ns = job->timed ? now_ns() : 0;
+    free(job);
+
+    if (c->kind == EV_FIFO_IN) {
+        c->busy = 1;   /* hasta entregar la respuesta por FIFO_RES */
+        clock_gettime(CLOCK_MONOTONIC, &fifo_deadline);
+        fifo_deadline.tv_sec += FIFO_GIVEUP_SEC;
+        fifo_out_open();
+        return;
+    }
+
+    int r = flush_out(c);
+    if (r < 0) { conn_close(c); return; }
+    if (r == 1 && try_dispatch(c) < 0) return;
+    watch_update(c);
+}
+
+static void drain_done(void) {
+    uint64_t cnt;
+    ssize_t r = read(wake_conn.fd, &cnt, sizeof(cnt));
+    (void)r;
+
+    pthread_mutex_lock(&done_lock);
+    Job *list = done_head;
+    done_head = NULL;
+    pthread_mutex_unlock(&done_lock);
+
+    /* la lista está invertida; el orden entre conexiones distintas no importa */
+    while (list) {
+        Job *next = list->next;
+        job_finish(list);
+        list = next;
+    }
+}
+
+static void accept_all(void) {
+    for (;;) {
+        int fd = accept4(listen_conn.fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept4");
+            return;
+        }
+        Conn *c = calloc(1, sizeof(Conn));
+        if (!c) { close(fd); continue; }
+        c->kind = EV_SOCKET;
+        c->fd = fd;
+        if (watch_add(c, EPOLLIN) != 0) { close(fd); free(c); }
+    }
+}
+
+/* --- recarga en caliente --- */
+
+static void *reload_main(void *arg) {
+    (void)arg;
+    if (search_reload() != 0)
+        fprintf(stderr, "Recarga fallida: se sigue con el índice anterior\n");
+    atomic_store(&reloading, 0);
+    return NULL;
+}
+
+static void handle_signal(void) {
+    struct signalfd_siginfo si;
+    while (read(signal_conn.fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+        if (si.ssi_signo == SIGUSR1) {
+            stats_dump(stderr);
+            continue;
+        }
+        if (si.ssi_signo != SIGHUP || atomic_exchange(&reloading, 1)) continue;
+        pthread_t th;
+        if (pthread_create(&th, NULL, reload_main, NULL) != 0) {
+            perror("pthread_create (recarga)");
+            atomic_store(&reloading, 0);
+            continue;
+        }
+        pthread_detach(th);
+    }
+}
+
+/* --- inicialización --- */
+
+int server_listen(const char *path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) { perror("socket"); return -1; }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Ruta de socket demasiado larga: %s\n", path);
+        close(fd);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        perror("bind/listen socket");
+        close(fd);
+        return -1;
+    }
+    chmod(path, 0666);   /* mismos permisos que los FIFOs */
+    return fd;
+}
+
+static int open_fifos(void) {
+    if (mkfifo(FIFO_REQ, 0666) == -1 && errno != EEXIST) { perror("mkfifo FIFO_REQ"); return -1; }
+    if (mkfifo(FIFO_RES, 0666) == -1 && errno != EEXIST) { perror("mkfifo FIFO_RES"); return -1; }
+    fifo_in.fd = open(FIFO_REQ, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fifo_in.fd < 0) { perror("open FIFO_REQ"); return -1; }
+    fifo_keep_fd = open(FIFO_REQ, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fifo_keep_fd < 0) { perror("open FIFO_REQ (writer)"); return -1; }
+    return watch_add(&fifo_in, EPOLLIN);
+}
+
+int server_run(const ServerConfig *cfg, Pool *pool) {
+    workers = pool;
+    max_queue = cfg->max_queue;
+    stats_watch_queue(&queued);
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) { perror("epoll_create1"); return -1; }
+
+    wake_conn.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    timer_conn.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (wake_conn.fd < 0 || timer_conn.fd < 0) { perror("eventfd/timerfd"); return -1; }
+    if (watch_add(&wake_conn, EPOLLIN) != 0 || watch_add(&timer_conn, EPOLLIN) != 0) {
+        perror("epoll_ctl");
+        return -1;
+    }
+
+    /* SIGHUP/SIGUSR1 deben estar bloqueadas desde antes de crear el pool (main) */
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGHUP);
+    sigaddset(&sigs, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+    signal_conn.fd = signalfd(-1, &sigs, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_conn.fd < 0 || watch_add(&signal_conn, EPOLLIN) != 0) {
+        perror("signalfd");
+        return -1;
+    }
+
+    if (cfg->listen_fd >= 0) {
+        /* socket heredado del supervisor: varios procesos esperan en él y
+         * EPOLLEXCLUSIVE despierta sólo a uno por conexión entrante */
+        listen_conn.fd = cfg->listen_fd;
+        if (watch_add(&listen_conn, EPOLLIN | EPOLLEXCLUSIVE) != 0) { perror("epoll_ctl listen"); return -1; }
+    } else if (cfg->sock_path) {
+        listen_conn.fd = server_listen(cfg->sock_path);
+        if (listen_conn.fd < 0 || watch_add(&listen_conn, EPOLLIN) != 0) return -1;
+    }
+    if (cfg->use_fifo && open_fifos() != 0) return -1;
+
+    struct epoll_event events[MAX_EVENTS];
+    for (;;) {
+        int n = epoll_wait(epfd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            return -1;
+        }
+        for (int i = 0; i < n; ++i) {
+            Conn *c = events[i].data.ptr;
+            uint32_t ev = events[i].events;
+            switch (c->kind) {
+            case EV_LISTEN:
+                accept_all();
+                break;
+            case EV_WAKE:
+                drain_done();
+                break;
+            case EV_TIMER: {
+                uint64_t exp;
+                ssize_t r = read(timer_conn.fd, &exp, sizeof(exp));
+                (void)r;
+                if (fifo_out.out && fifo_out.fd < 0) fifo_out_open();
+                break;
+            }
+            case EV_SIGNAL:
+                handle_signal();
+                break;
+            case EV_FIFO_IN:
+                conn_read(c);
+                break;
+            case EV_FIFO_OUT:
+                if (ev & (EPOLLERR | EPOLLHUP)) fifo_out_done();
+                else fifo_out_flush();
+                break;
+            case EV_SOCKET:
+                if (c->fd < 0) break;   /* cerrada antes en este mismo lote */
+                if (ev & EPOLLERR) { conn_close(c); break; }
+                if (ev & EPOLLOUT) {
+                    int r = flush_out(c);
+                    if (r < 0) { conn_close(c); break; }
+                    if (r == 1 && try_dispatch(c) < 0) break;
+                }
+                if (ev & EPOLLIN) { conn_read(c); break; }
+                /* HUP sin datos por leer (p. ej. mientras busy): cerrar */
+                if (ev & EPOLLHUP) conn_close(c);
+                else watch_update(c);
+                break;
+            }
+        }
+        conn_reap();
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "pool.h"
+
+/* Configuración del bucle de eventos del daemon. */
+typedef struct {
+    const char *sock_path;   /* socket UNIX de escucha (NULL: sin socket) */
+    int use_fifo;            /* atender también el protocolo FIFO_REQ/FIFO_RES */
+    int max_queue;           /* peticiones esperando un hilo antes de responder
+                                RES_BUSY (0: sin límite) */
+    int listen_fd;           /* socket ya creado y compartido (pre-fork), o -1
+                                para crearlo en sock_path */
+} ServerConfig;
+
+/* Crea el socket UNIX de escucha (no bloqueante) en path. fd, o -1. */
+int server_listen(const char *path);
+
+/* Bucle de eventos (epoll): acepta conexiones, arma mensajes completos,
+ * los despacha al pool y escribe las respuestas sin bloquear.
+ * Sólo retorna (-1) si no puede inicializarse. */
+int server_run(const ServerConfig *cfg, Pool *pool);
+
+#endif
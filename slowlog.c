@@ -0,0 +1,37 @@
+/* slowlog.c
+ * Registro de consultas lentas (ver slowlog.h). Sólo guarda el descriptor y
+ * el umbral; el contenido de cada entrada lo arma search.c, que es quien
+ * tiene el perfil de la consulta.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "slowlog.h"
+#include "util.h"
+
+static int log_fd = -1;
+static long long threshold_ns;
+
+int slowlog_open(const char *path, int threshold_ms) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    log_fd = fd;
+    threshold_ns = (long long)threshold_ms * 1000000LL;
+    return 0;
+}
+
+int slowlog_enabled(void) {
+    return log_fd >= 0;
+}
+
+int slowlog_is_slow(long long ns) {
+    return log_fd >= 0 && ns > threshold_ns;
+}
+
+void slowlog_write(const char *entry, size_t len) {
+    if (log_fd < 0) return;
+    /* O_APPEND: cada write() va entero al final del archivo */
+    (void)write_full(log_fd, entry, len);
+}
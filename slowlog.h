@@ -0,0 +1,26 @@
+#ifndef SLOWLOG_H
+#define SLOWLOG_H
+
+#include <stddef.h>
+
+#define SLOW_LOG_FILE "p1-slow.log"
+
+/* Registro de consultas lentas (opcional, -S ms): cada mensaje que tarda más
+ * que el umbral (llegada → respuesta lista) deja una línea por consulta con
+ * su perfil de ejecución. El archivo se abre en modo O_APPEND y cada línea
+ * se escribe con un solo write(), así hilos y procesos (pre-fork) no mezclan
+ * sus entradas. */
+
+/* Abre (o crea) path para agregar; threshold_ms >= 0. 0, o -1 con errno. */
+int slowlog_open(const char *path, int threshold_ms);
+
+/* 1 si hay registro abierto. */
+int slowlog_enabled(void);
+
+/* 1 si una duración de ns supera el umbral. */
+int slowlog_is_slow(long long ns);
+
+/* Agrega una entrada (una línea terminada en '\n'). */
+void slowlog_write(const char *entry, size_t len);
+
+#endif
@@ -0,0 +1,249 @@
+/* stats.c
+ * Contadores e histogramas del proceso (ver stats.h).
+ *
+ * Contadores: cada hilo tiene su bloque, creado la primera vez que cuenta y
+ * enlazado en una lista global (el único lock, una vez por hilo). Sólo ese
+ * hilo lo escribe, con load/store relajados: en x86 es un add normal sobre
+ * una línea de caché propia. Los lectores suman los bloques de todos.
+ *
+ * Histogramas tipo HDR: por cada potencia de 2 de nanosegundos hay 16
+ * sub-cubetas lineales, así el error relativo queda por debajo de 1/16 en
+ * todo el rango (de ns a horas) con ~700 contadores atómicos por histograma.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include "stats.h"
+#include "util.h"
+
+#define SUB_BITS 4
+#define SUB_COUNT (1 << SUB_BITS)
+#define MAX_EXP 47                     /* 2^47 ns ~ 39 horas */
+#define HIST_BUCKETS (SUB_COUNT + (MAX_EXP - SUB_BITS + 1) * SUB_COUNT)
+
+typedef struct {
+    atomic_ulong count[HIST_BUCKETS];
+    atomic_llong sum_ns;
+    atomic_llong max_ns;
+} Histogram;
+
+typedef struct ThreadStats {
+    atomic_ulong v[N_COUNTERS];
+    struct ThreadStats *next;
+} ThreadStats;
+
+const char *const stage_names[N_STAGES] = {
+    "parse", "open", "walk", "match", "fetch", "filter", "write",
+};
+
+static const char *const counter_names[N_COUNTERS] = {
+    "requests", "queries", "batches", "na", "truncated", "busy", "loading", "errors",
+    "entries_scanned", "key_matches", "csv_reads", "csv_bytes", "fetch_reuse", "mph_lookups", "swiss_lookups", "swiss_groups",
+    "btree_scans", "btree_pages", "unsupported", "suggests", "fuzzy_queries", "fuzzy_nodes", "sa_queries", "sa_steps", "slow",
+    "hw_scans",
+};
+
+static Histogram stage_hist[N_STAGES];
+static Histogram latency_hist;
+static atomic_int time_all;
+static atomic_int *queue_gauge;
+static long long start_ns;
+
+static pthread_mutex_t threads_lock = PTHREAD_MUTEX_INITIALIZER;
+static ThreadStats *threads;
+static _Thread_local ThreadStats *local;
+
+void stats_configure(int all_queries) {
+    atomic_store(&time_all, all_queries);
+}
+
+void stats_watch_queue(atomic_int *queued) {
+    queue_gauge = queued;
+    start_ns = now_ns();
+}
+
+int stats_timing_wanted(const Request *req) {
+    return atomic_load_explicit(&time_all, memory_order_relaxed) || (req->flags & REQ_TIMING);
+}
+
+void stats_add(int counter, unsigned long v) {
+    if (!local) {
+        ThreadStats *t = calloc(1, sizeof(ThreadStats));
+        if (!t) return;
+        pthread_mutex_lock(&threads_lock);
+        t->next = threads;
+        threads = t;
+        pthread_mutex_unlock(&threads_lock);
+        local = t;
+    }
+    atomic_ulong *c = &local->v[counter];
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+void stats_add_hw(const unsigned long long hw[N_HW]) {
+    stats_add(STAT_HW_SCANS, 1);
+    for (int k = 0; k < N_HW; ++k) stats_add(STAT_HW_FIRST + k, (unsigned long)hw[k]);
+}
+
+static unsigned long counter_total(int counter) {
+    unsigned long sum = 0;
+    pthread_mutex_lock(&threads_lock);
+    for (ThreadStats *t = threads; t; t = t->next)
+        sum += atomic_load_explicit(&t->v[counter], memory_order_relaxed);
+    pthread_mutex_unlock(&threads_lock);
+    return sum;
+}
+
+/* --- histogramas --- */
+
+static int bucket_of(long long ns) {
+    if (ns < SUB_COUNT) return (int)ns;
+    int exp = 63 - __builtin_clzll((unsigned long long)ns);
+    if (exp > MAX_EXP) return HIST_BUCKETS - 1;
+    int sub = (int)((ns >> (exp - SUB_BITS)) & (SUB_COUNT - 1));
+    return SUB_COUNT + (exp - SUB_BITS) * SUB_COUNT + sub;
+}
+
+/* Punto medio de la cubeta b, en ns. */
+static double bucket_mid(int b) {
+    if (b < SUB_COUNT) return (double)b;
+    int exp = (b - SUB_COUNT) / SUB_COUNT + SUB_BITS;
+    int sub = (b - SUB_COUNT) % SUB_COUNT;
+    double width = (double)(1LL << (exp - SUB_BITS));
+    return (double)(1LL << exp) + width * ((double)sub + 0.5);
+}
+
+static void hist_record(Histogram *h, long long ns) {
+    if (ns < 0) ns = 0;
+    atomic_fetch_add_explicit(&h->count[bucket_of(ns)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum_ns, ns, memory_order_relaxed);
+    long long max = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+    while (ns > max && !atomic_compare_exchange_weak_explicit(&h->max_ns, &max, ns,
+                                                               memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+void stats_record(int stage, long long ns) {
+    if (stage >= 0 && stage < N_STAGES) hist_record(&stage_hist[stage], ns);
+}
+
+void stats_record_latency(long long ns) {
+    hist_record(&latency_hist, ns);
+}
+
+typedef struct {
+    unsigned long n;
+    double mean_us, max_us;
+    double p_us[4];          /* p50, p90, p99, p999 */
+} HistSummary;
+
+static void hist_summary(Histogram *h, HistSummary *out) {
+    static const double pct[4] = { 50, 90, 99, 99.9 };
+    unsigned long *cnt = malloc(sizeof(unsigned long) * HIST_BUCKETS);
+    memset(out, 0, sizeof(*out));
+    if (!cnt) return;
+    for (int b = 0; b < HIST_BUCKETS; ++b) {
+        cnt[b] = atomic_load_explicit(&h->count[b], memory_order_relaxed);
+        out->n += cnt[b];
+    }
+    out->max_us = (double)atomic_load_explicit(&h->max_ns, memory_order_relaxed) / 1000.0;
+    if (out->n) out->mean_us = (double)atomic_load_explicit(&h->sum_ns, memory_order_relaxed) / (double)out->n / 1000.0;
+    for (int k = 0; k < 4 && out->n; ++k) {
+        unsigned long rank = (unsigned long)(pct[k] / 100.0 * (double)out->n + 0.999999);
+        unsigned long acc = 0;
+        for (int b = 0; b < HIST_BUCKETS; ++b) {
+            acc += cnt[b];
+            if (acc >= rank) { out->p_us[k] = bucket_mid(b) / 1000.0; break; }
+        }
+        if (out->p_us[k] > out->max_us) out->p_us[k] = out->max_us;
+    }
+    free(cnt);
+}
+
+/* --- salida --- */
+
+static void append(char *buf, size_t sz, size_t *len, const char *fmt, ...) __attribute__((format(printf, 4, 5)));
+static void append(char *buf, size_t sz, size_t *len, const char *fmt, ...) {
+    if (*len + 1 >= sz) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + *len, sz - *len, fmt, ap);
+    va_end(ap);
+    if (n > 0) *len += (size_t)n;
+    if (*len >= sz) *len = sz - 1;
+}
+
+/* read_bytes de /proc/self/io (lo que el proceso hizo leer del disco, no de
+ * la caché de páginas), o -1 si no está disponible. */
+static long long proc_read_bytes(void) {
+    FILE *f = fopen("/proc/self/io", "r");
+    if (!f) return -1;
+    char line[128];
+    long long v = -1;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "read_bytes: %lld", &v) == 1) break;
+    fclose(f);
+    return v;
+}
+
+size_t stats_format(char *buf, size_t sz) {
+    size_t len = 0;
+    if (sz == 0) return 0;
+    buf[0] = '\0';
+    append(buf, sz, &len, "STATS pid=%d uptime_s=%lld queue=%d\n", (int)getpid(),
+           start_ns ? (now_ns() - start_ns) / 1000000000LL : 0LL,
+           queue_gauge ? atomic_load_explicit(queue_gauge, memory_order_relaxed) : 0);
+    for (int c = 0; c < STAT_HW_SCANS; ++c)
+        append(buf, sz, &len, "%s=%lu%s", counter_names[c], counter_total(c),
+               c == STAT_HW_SCANS - 1 || c == STAT_ERRORS ? "\n" : " ");
+
+    if (perfctr_enabled()) {
+        /* medias por recorrido: ¿está limitado por memoria o por el kernel? */
+        unsigned long scans = counter_total(STAT_HW_SCANS);
+        unsigned long long hw[N_HW];
+        for (int k = 0; k < N_HW; ++k) hw[k] = counter_total(STAT_HW_FIRST + k);
+        int avail = perfctr_available();
+        append(buf, sz, &len, "hw_per_scan n=%lu", scans);
+        for (int k = 0; k < N_HW; ++k) {
+            if (avail & (1 << k)) append(buf, sz, &len, " %s=%.0f", hw_names[k], scans ? (double)hw[k] / (double)scans : 0.0);
+            else append(buf, sz, &len, " %s=n/a", hw_names[k]);
+        }
+        unsigned long entries = counter_total(STAT_ENTRIES);
+        if ((avail & (1 << HW_CYCLES)) && (avail & (1 << HW_INSTRUCTIONS)) && hw[HW_CYCLES])
+            append(buf, sz, &len, " ipc=%.2f", (double)hw[HW_INSTRUCTIONS] / (double)hw[HW_CYCLES]);
+        if ((avail & (1 << HW_LLC_MISSES)) && entries)
+            append(buf, sz, &len, " llc_misses_per_entry=%.3f", (double)hw[HW_LLC_MISSES] / (double)entries);
+        append(buf, sz, &len, "\n");
+    }
+
+    /* fallos de página mayores y lecturas de disco del proceso: en frío,
+     * cuánto del índice y del CSV hubo que traer del disco */
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0)
+        append(buf, sz, &len, "io major_faults=%ld minor_faults=%ld disk_read_bytes=%lld\n",
+               ru.ru_majflt, ru.ru_minflt, proc_read_bytes());
+
+    HistSummary h;
+    hist_summary(&latency_hist, &h);
+    append(buf, sz, &len, "latency_us n=%lu mean=%.1f p50=%.1f p90=%.1f p99=%.1f p999=%.1f max=%.1f\n",
+           h.n, h.mean_us, h.p_us[0], h.p_us[1], h.p_us[2], h.p_us[3], h.max_us);
+    for (int s = 0; s < N_STAGES; ++s) {
+        hist_summary(&stage_hist[s], &h);
+        if (h.n == 0) continue;
+        append(buf, sz, &len, "stage_%s_us n=%lu mean=%.1f p50=%.1f p90=%.1f p99=%.1f max=%.1f\n",
+               stage_names[s], h.n, h.mean_us, h.p_us[0], h.p_us[1], h.p_us[2], h.max_us);
+    }
+    return len;
+}
+
+void stats_dump(FILE *f) {
+    char buf[4096];
+    stats_format(buf, sizeof(buf));
+    fputs(buf, f);
+    fflush(f);
+}
@@ -0,0 +1,79 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "common.h"
+#include "perfctr.h"
+
+/* Métricas del proceso: contadores por hilo (cada hilo escribe sólo los
+ * suyos, sin operaciones atómicas de lectura-modificación; la lectura suma
+ * los de todos) e histogramas de latencia tipo HDR (precisión ~6%).
+ *  - Tiempos por etapa (STAGE_* de common.h): se registran las consultas con
+ *    REQ_TIMING y, con stats_configure(1) (opción -M del daemon), todas.
+ *  - Latencia de cada mensaje (llegada → respuesta lista): siempre.
+ * Una Request STATS_TAG o SIGUSR1 devuelven el resumen (stats_format). */
+
+enum {
+    STAT_REQUESTS,          /* mensajes resueltos (un lote cuenta uno) */
+    STAT_QUERIES,           /* consultas de título ejecutadas */
+    STAT_BATCHES,           /* lotes */
+    STAT_NA,                /* consultas sin resultados */
+    STAT_TRUNCATED,         /* respuestas con RES_TRUNCATED */
+    STAT_BUSY,              /* consultas rechazadas con RES_BUSY */
+    STAT_LOADING,           /* consultas respondidas LOADING */
+    STAT_ERRORS,            /* cabeceras inválidas y búsquedas fallidas */
+    STAT_ENTRIES,           /* EntryDisk recorridas */
+    STAT_MATCHES,           /* claves que coincidieron */
+    STAT_CSV_READS,         /* registros leídos del CSV */
+    STAT_CSV_BYTES,         /* bytes de esos registros */
+    STAT_FETCH_REUSE,       /* registro ya leído reutilizado por otra consulta del lote */
+    STAT_MPH_LOOKUPS,       /* consultas exactas resueltas con index.mph (-x) */
+    STAT_SWISS_LOOKUPS,     /* consultas exactas resueltas con index.swt (-X) */
+    STAT_SWISS_GROUPS,      /* grupos de control de index.swt recorridos */
+    STAT_BTREE_SCANS,       /* consultas resueltas con el árbol B+ */
+    STAT_BTREE_PAGES,       /* nodos del árbol B+ leídos */
+    STAT_UNSUPPORTED,       /* REQ_PREFIX/REQ_RANGE sin árbol B+ */
+    STAT_SUGGESTS,          /* pedidos SUGGEST_TAG resueltos con el trie (-A) */
+    STAT_FUZZY,             /* consultas REQ_FUZZY resueltas con el trie */
+    STAT_FUZZY_NODES,       /* nodos del trie recorridos por ellas */
+    STAT_SA_QUERIES,        /* consultas por subcadena resueltas con index.sa (-U) */
+    STAT_SA_STEPS,          /* sufijos comparados por ellas */
+    STAT_SLOW,              /* mensajes escritos en el registro de lentas (-S) */
+    STAT_HW_SCANS,          /* búsquedas con contadores de hardware (-H) */
+    STAT_HW_FIRST,          /* sumas de los HW_* de perfctr.h, en ese orden */
+    N_COUNTERS = STAT_HW_FIRST + N_HW
+};
+
+extern const char *const stage_names[N_STAGES];
+
+/* all_queries: medir las etapas de todas las consultas, no sólo REQ_TIMING. */
+void stats_configure(int all_queries);
+
+/* Contador de trabajos en espera del servidor, para informar la cola. */
+void stats_watch_queue(atomic_int *queued);
+
+/* 1 si las etapas de req se miden. */
+int stats_timing_wanted(const Request *req);
+
+/* Suma v al contador c del hilo actual. */
+void stats_add(int counter, unsigned long v);
+
+/* Suma los deltas de contadores de hardware de una búsqueda. */
+void stats_add_hw(const unsigned long long hw[N_HW]);
+
+/* Suma una duración (ns) al histograma de la etapa. */
+void stats_record(int stage, long long ns);
+
+/* Latencia de un mensaje, de la llegada a la respuesta lista (ns). */
+void stats_record_latency(long long ns);
+
+/* Resumen en texto (contadores, cola y percentiles) en buf, terminado en
+ * '\0'; devuelve la longitud escrita. */
+size_t stats_format(char *buf, size_t sz);
+
+/* stats_format a un FILE. */
+void stats_dump(FILE *f);
+
+#endif
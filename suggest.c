@@ -0,0 +1,414 @@
+/* suggest.c
+ * Autocompletado con trie comprimido (ver suggest.h):
+ *  - se juntan (título normalizado, peso, offset) de cada registro, se
+ *    ordenan y los repetidos se suman en un solo título
+ *  - el trie se arma de arriba abajo sobre el arreglo ordenado: los títulos
+ *    de un nodo forman un rango, que se parte por el byte siguiente; cada
+ *    parte baja por una arista con el prefijo común de su rango (el del
+ *    primero y el último). Los hijos de un nodo quedan contiguos en nodes
+ *  - top-k: se baja por el prefijo (que puede terminar a mitad de una
+ *    arista) y se saca de un heap por peso: un nodo entra con max_weight y,
+ *    al salir, deja su propio título (con weight) y sus hijos
+ *  - aproximada: recorrido en profundidad con una fila de Levenshtein por
+ *    byte de la arista, sólo dentro de la banda |i - j| <= k
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "suggest.h"
+#include "hash.h"
+#include "index.h"
+#include "util.h"
+
+#define MAX_RECORD_PREFIX 65536 /* versions_count va después del abstract */
+
+/* --- construcción --- */
+
+typedef struct {
+    size_t key;                 /* offset en el arena de títulos normalizados */
+    uint64_t csv_offset;
+    uint32_t weight;
+    uint32_t record, n_records; /* tras juntar los repetidos: sus registros */
+} Title;
+
+/* Para qsort_r: keys es el arena de los Title (sin estado global, así dos
+ * generaciones pueden construirse a la vez durante una recarga). */
+static int cmp_title(const void *a, const void *b, void *keys) {
+    const Title *x = a, *y = b;
+    const char *k = keys;
+    int c = strcmp(k + x->key, k + y->key);
+    if (c) return c;
+    return (x->csv_offset > y->csv_offset) - (x->csv_offset < y->csv_offset);
+}
+
+typedef struct {
+    Suggest *s;
+    const char *keys;
+    const Title *titles;
+    long nodes_cap;
+    size_t labels_cap;
+} Builder;
+
+static long new_nodes(Builder *b, long n) {
+    Suggest *s = b->s;
+    if (s->n_nodes + n > b->nodes_cap) {
+        long cap = b->nodes_cap * 2 + n;
+        SuggestNode *nn = realloc(s->nodes, sizeof(SuggestNode) * (size_t)cap);
+        if (!nn) return -1;
+        s->nodes = nn;
+        b->nodes_cap = cap;
+    }
+    memset(s->nodes + s->n_nodes, 0, sizeof(SuggestNode) * (size_t)n);
+    s->n_nodes += n;
+    return s->n_nodes - n;
+}
+
+static long add_label(Builder *b, const char *p, size_t len) {
+    Suggest *s = b->s;
+    if (s->labels_size + len > b->labels_cap) {
+        size_t cap = b->labels_cap * 2 + len;
+        char *nl = realloc(s->labels, cap);
+        if (!nl) return -1;
+        s->labels = nl;
+        b->labels_cap = cap;
+    }
+    memcpy(s->labels + s->labels_size, p, len);
+    s->labels_size += len;
+    return (long)(s->labels_size - len);
+}
+
+/* Completa el nodo node con los títulos [lo, hi), que comparten sus primeros
+ * depth bytes. 0, o -1 sin memoria. */
+static int build_node(Builder *b, long node, long lo, long hi, size_t depth) {
+    const char *first = b->keys + b->titles[lo].key;
+    uint32_t max = 0;
+    if (first[depth] == '\0') {   /* el título que termina aquí va primero */
+        b->s->nodes[node].weight = b->titles[lo].weight;
+        b->s->nodes[node].record = b->titles[lo].record;
+        b->s->nodes[node].n_records = b->titles[lo].n_records;
+        max = b->titles[lo].weight;
+        lo++;
+    }
+    long n_children = 0;
+    for (long i = lo; i < hi; ) {
+        unsigned char c = (unsigned char)b->keys[b->titles[i].key + depth];
+        while (i < hi && (unsigned char)b->keys[b->titles[i].key + depth] == c) i++;
+        n_children++;
+    }
+    long child = n_children ? new_nodes(b, n_children) : 0;
+    if (child < 0) return -1;
+    b->s->nodes[node].first_child = (uint32_t)child;
+    b->s->nodes[node].n_children = (uint16_t)n_children;
+
+    for (long i = lo; i < hi; ++child) {
+        long start = i;
+        unsigned char c = (unsigned char)b->keys[b->titles[i].key + depth];
+        while (i < hi && (unsigned char)b->keys[b->titles[i].key + depth] == c) i++;
+        /* prefijo común del rango: el del primero y el último */
+        const char *a = b->keys + b->titles[start].key, *z = b->keys + b->titles[i - 1].key;
+        size_t end = depth;
+        while (a[end] && a[end] == z[end]) end++;
+        long label = add_label(b, a + depth, end - depth);
+        if (label < 0) return -1;
+        b->s->nodes[child].label = (uint32_t)label;
+        b->s->nodes[child].label_len = (uint16_t)(end - depth);
+        if (build_node(b, child, start, i, end) != 0) return -1;
+        if (b->s->nodes[child].max_weight > max) max = b->s->nodes[child].max_weight;
+    }
+    b->s->nodes[node].max_weight = max;
+    return 0;
+}
+
+int suggest_build(Suggest *s, const char *csv, size_t size) {
+    memset(s, 0, sizeof(*s));
+    char *rec = malloc(MAX_RECORD_PREFIX);
+    size_t keys_cap = 1 << 20, keys_used = 0;
+    char *keys = malloc(keys_cap);
+    long cap = 1 << 16, n = 0;
+    Title *titles = malloc(sizeof(Title) * (size_t)cap);
+    int rc = -1;
+    if (!rec || !keys || !titles) goto out;
+
+    const char *p = csv, *end = csv + size;
+    int header = 1;
+    while (p < end) {
+        size_t len = csv_record_len(p, (size_t)(end - p));
+        if (len == 0) break;
+        size_t copy = len < MAX_RECORD_PREFIX - 1 ? len : MAX_RECORD_PREFIX - 1;
+        memcpy(rec, p, copy);
+        rec[copy] = '\0';
+        uint64_t offset = (uint64_t)(p - csv);
+        p += len;
+        if (header) { header = 0; continue; }
+        char key[KEY_SIZE], norm[KEY_SIZE], versions[32];
+        if (!csv_get_column(rec, 4, key, sizeof(key)) || key[0] == '\0') continue;
+        size_t norm_len = hash_normalize(key, norm, sizeof(norm));
+        if (norm_len == 0) continue;
+        long w = csv_get_column(rec, 13, versions, sizeof(versions)) ? atol(versions) : 0;
+
+        if (keys_used + norm_len + 1 > keys_cap) {
+            char *nk = realloc(keys, keys_cap *= 2);
+            if (!nk) goto out;
+            keys = nk;
+        }
+        if (n == cap) {
+            Title *nt = realloc(titles, sizeof(Title) * (size_t)(cap *= 2));
+            if (!nt) goto out;
+            titles = nt;
+        }
+        memcpy(keys + keys_used, norm, norm_len + 1);
+        titles[n].key = keys_used;
+        titles[n].csv_offset = offset;
+        titles[n].weight = w < 1 ? 1 : w > 65535 ? 65535 : (uint32_t)w;
+        keys_used += norm_len + 1;
+        n++;
+    }
+
+    /* títulos repetidos: uno solo, con la suma de los pesos y sus registros
+     * seguidos en records */
+    qsort_r(titles, (size_t)n, sizeof(Title), cmp_title, keys);
+    if (!(s->records = malloc(sizeof(uint64_t) * (size_t)(n ? n : 1)))) goto out;
+    s->n_records = n;
+    long u = 0;
+    for (long i = 0; i < n; ++i) {
+        s->records[i] = titles[i].csv_offset;
+        if (u > 0 && strcmp(keys + titles[u - 1].key, keys + titles[i].key) == 0) {
+            titles[u - 1].weight += titles[i].weight;
+            titles[u - 1].n_records++;
+            continue;
+        }
+        titles[u] = titles[i];
+        titles[u].record = (uint32_t)i;
+        titles[u].n_records = 1;
+        u++;
+    }
+
+    Builder b = { s, keys, titles, 0, 0 };
+    if (new_nodes(&b, 1) < 0) goto out;
+    if (u > 0 && build_node(&b, 0, 0, u, 0) != 0) goto out;
+    s->n_titles = u;
+    rc = 0;
+out:
+    if (rc != 0) {
+        fprintf(stderr, "Sin memoria (autocompletado)\n");
+        suggest_free(s);
+    }
+    free(rec);
+    free(keys);
+    free(titles);
+    return rc;
+}
+
+void suggest_free(Suggest *s) {
+    free(s->nodes);
+    free(s->labels);
+    free(s->records);
+    memset(s, 0, sizeof(*s));
+}
+
+/* --- consulta --- */
+
+/* Elemento del heap: un nodo por abrir (su max_weight) o su título (weight). */
+typedef struct {
+    uint32_t weight;
+    uint32_t node;
+    int title;
+} Item;
+
+static int item_before(const Item *a, const Item *b) {
+    if (a->weight != b->weight) return a->weight > b->weight;
+    if (a->node != b->node) return a->node < b->node;
+    return a->title > b->title;   /* el título antes que sus descendientes */
+}
+
+typedef struct {
+    Item *v;
+    long n, cap;
+} Heap;
+
+static int heap_push(Heap *h, Item it) {
+    if (h->n == h->cap) {
+        long cap = h->cap * 2 + 64;
+        Item *nv = realloc(h->v, sizeof(Item) * (size_t)cap);
+        if (!nv) return -1;
+        h->v = nv;
+        h->cap = cap;
+    }
+    long i = h->n++;
+    while (i > 0 && item_before(&it, &h->v[(i - 1) / 2])) {
+        h->v[i] = h->v[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    h->v[i] = it;
+    return 0;
+}
+
+static Item heap_pop(Heap *h) {
+    Item top = h->v[0], last = h->v[--h->n];
+    long i = 0;
+    for (;;) {
+        long c = 2 * i + 1;
+        if (c >= h->n) break;
+        if (c + 1 < h->n && item_before(&h->v[c + 1], &h->v[c])) c++;
+        if (!item_before(&h->v[c], &last)) break;
+        h->v[i] = h->v[c];
+        i = c;
+    }
+    if (h->n > 0) h->v[i] = last;
+    return top;
+}
+
+/* Hijo de node cuyo tramo empieza con c (los hijos van ordenados), o -1. */
+static long find_child(const Suggest *s, const SuggestNode *node, unsigned char c) {
+    long lo = node->first_child, hi = lo + node->n_children - 1;
+    while (lo <= hi) {
+        long mid = (lo + hi) / 2;
+        unsigned char m = (unsigned char)s->labels[s->nodes[mid].label];
+        if (m == c) return mid;
+        if (m < c) lo = mid + 1; else hi = mid - 1;
+    }
+    return -1;
+}
+
+int suggest_top(const Suggest *s, const char *prefix, int k, uint64_t *offsets, uint32_t *weights) {
+    if (!s->nodes || k <= 0) return 0;
+    if (k > SUGGEST_MAX_K) k = SUGGEST_MAX_K;
+    char norm[KEY_SIZE];
+    size_t len = hash_normalize(prefix, norm, sizeof(norm));
+    /* "dark matter " se normaliza sin el espacio final: se lo devuelve para
+     * no sugerir "dark matters" a quien ya terminó la palabra */
+    size_t raw = strlen(prefix);
+    if (len > 0 && len + 1 < sizeof(norm) && raw > 0 && (prefix[raw - 1] == ' ' || prefix[raw - 1] == '\t')) {
+        norm[len++] = ' ';
+        norm[len] = '\0';
+    }
+
+    long node = 0;
+    for (size_t depth = 0; depth < len; ) {
+        node = find_child(s, &s->nodes[node], (unsigned char)norm[depth]);
+        if (node < 0) return 0;
+        const SuggestNode *nd = &s->nodes[node];
+        size_t m = len - depth < nd->label_len ? len - depth : nd->label_len;
+        if (memcmp(s->labels + nd->label, norm + depth, m) != 0) return 0;
+        depth += m;
+    }
+
+    Heap h = { 0 };
+    int found = 0;
+    if (heap_push(&h, (Item){ s->nodes[node].max_weight, (uint32_t)node, 0 }) != 0) return 0;
+    while (h.n > 0 && found < k) {
+        Item it = heap_pop(&h);
+        const SuggestNode *nd = &s->nodes[it.node];
+        if (it.title) {
+            offsets[found] = s->records[nd->record];
+            weights[found] = nd->weight;
+            found++;
+            continue;
+        }
+        if (nd->weight && heap_push(&h, (Item){ nd->weight, it.node, 1 }) != 0) break;
+        for (uint32_t c = nd->first_child; c < nd->first_child + nd->n_children; ++c)
+            if (heap_push(&h, (Item){ s->nodes[c].max_weight, c, 0 }) != 0) break;
+    }
+    free(h.v);
+    return found;
+}
+
+/* --- búsqueda aproximada --- */
+
+typedef struct {
+    const Suggest *s;
+    const char *p;              /* consulta normalizada */
+    int m;                      /* su largo */
+    int k;                      /* distancia máxima pedida */
+    uint8_t *rows;              /* fila i (prefijo de i bytes): rows + i * (m + 1) */
+    SuggestMatch *out;
+    int max, n;
+    long visited;
+} Fuzzy;
+
+static int match_before(const Fuzzy *f, const SuggestMatch *a, const SuggestMatch *b) {
+    if (a->dist != b->dist) return a->dist < b->dist;
+    return f->s->nodes[a->node].weight > f->s->nodes[b->node].weight;
+}
+
+/* Peor de los max ya elegidos (con out lleno). */
+static int worst_match(const Fuzzy *f) {
+    int w = 0;
+    for (int i = 1; i < f->n; ++i)
+        if (match_before(f, &f->out[w], &f->out[i])) w = i;
+    return w;
+}
+
+/* Distancia más alta que todavía puede entrar: k, o la del peor elegido
+ * cuando ya hay max (uno a esa distancia entra si pesa más). */
+static int bound(const Fuzzy *f) {
+    return f->n < f->max ? f->k : f->out[worst_match(f)].dist;
+}
+
+static void add_match(Fuzzy *f, uint32_t node, int dist) {
+    SuggestMatch c = { node, dist };
+    if (f->n < f->max) { f->out[f->n++] = c; return; }
+    int w = worst_match(f);
+    if (match_before(f, &c, &f->out[w])) f->out[w] = c;
+}
+
+/* Recorre node, cuyo tramo empieza en el byte depth del título. */
+static void fuzzy_node(Fuzzy *f, uint32_t node, int depth) {
+    const SuggestNode *nd = &f->s->nodes[node];
+    const int m = f->m, cap = f->k + 1;
+    f->visited++;
+    for (int l = 0; l < nd->label_len; ++l) {
+        int i = depth + l + 1;
+        if (i > m + f->k) return;   /* ya sobran más de k bytes */
+        const uint8_t *prev = f->rows + (size_t)(i - 1) * (size_t)(m + 1);
+        uint8_t *row = f->rows + (size_t)i * (size_t)(m + 1);
+        unsigned char c = (unsigned char)f->s->labels[nd->label + (uint32_t)l];
+        int lo = i - f->k > 1 ? i - f->k : 1, hi = i + f->k < m ? i + f->k : m;
+        int best = cap;
+        memset(row, cap, (size_t)(m + 1));
+        row[0] = (uint8_t)(i < cap ? i : cap);
+        if (lo == 1) best = row[0];
+        for (int j = lo; j <= hi; ++j) {
+            int d = prev[j - 1] + ((unsigned char)f->p[j - 1] != c);
+            if (prev[j] + 1 < d) d = prev[j] + 1;
+            if (row[j - 1] + 1 < d) d = row[j - 1] + 1;
+            if (d > cap) d = cap;
+            row[j] = (uint8_t)d;
+            if (d < best) best = d;
+        }
+        if (best > bound(f)) return;    /* ningún título de abajo entra */
+    }
+    int end = depth + nd->label_len;
+    const uint8_t *row = f->rows + (size_t)end * (size_t)(m + 1);
+    if (nd->weight && row[m] <= bound(f)) add_match(f, node, row[m]);
+    for (uint32_t c = nd->first_child; c < nd->first_child + nd->n_children; ++c)
+        fuzzy_node(f, c, end);
+}
+
+int suggest_fuzzy(const Suggest *s, const char *norm, int k, SuggestMatch *out, int max, long *visited) {
+    *visited = 0;
+    if (!s->nodes || max <= 0) return 0;
+    if (k < 0) k = 0;
+    if (k > FUZZY_MAX_EDITS) k = FUZZY_MAX_EDITS;
+    Fuzzy f = { .s = s, .p = norm, .m = (int)strlen(norm), .k = k, .out = out, .max = max };
+    /* un título largo no puede estar a <= k de la consulta si la supera en
+     * más de k bytes: bastan m + k + 1 filas */
+    f.rows = malloc((size_t)(f.m + k + 1) * (size_t)(f.m + 1));
+    if (!f.rows) return -1;
+    for (int j = 0; j <= f.m; ++j) f.rows[j] = (uint8_t)(j < k + 1 ? j : k + 1);
+    if (s->nodes[0].weight && f.rows[f.m] <= k) add_match(&f, 0, f.rows[f.m]);
+    for (uint32_t c = s->nodes[0].first_child; c < s->nodes[0].first_child + s->nodes[0].n_children; ++c)
+        fuzzy_node(&f, c, 0);
+    free(f.rows);
+    for (int i = 1; i < f.n; ++i) {     /* pocos: inserción */
+        SuggestMatch c = out[i];
+        int j = i;
+        for (; j > 0 && match_before(&f, &c, &out[j - 1]); --j) out[j] = out[j - 1];
+        out[j] = c;
+    }
+    *visited = f.visited;
+    return f.n;
+}
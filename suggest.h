@@ -0,0 +1,66 @@
+#ifndef SUGGEST_H
+#define SUGGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Autocompletado de títulos (opcional, -A): trie comprimido (radix) en
+ * memoria sobre los títulos normalizados (hash_normalize). Cada arista
+ * guarda un tramo del título y cada nodo el peso del título que termina en
+ * él y el máximo peso de su subárbol, así las k mejores terminaciones de un
+ * prefijo salen de una búsqueda por el mejor primero que sólo abre los
+ * subárboles que todavía pueden entrar. El peso de un título es la suma de
+ * versions_count (columna 13, mínimo 1) de sus registros.
+ *
+ * El mismo trie responde las búsquedas aproximadas (REQ_FUZZY): recorrerlo
+ * con una fila de la matriz de Levenshtein por byte simula el autómata de
+ * Levenshtein de la consulta sobre todos los títulos a la vez; un subárbol se
+ * abandona en cuanto ningún prefijo suyo puede quedar a distancia <= k. */
+
+#define SUGGEST_MAX_K 50
+
+typedef struct {
+    uint32_t label;             /* offset del tramo en labels */
+    uint16_t label_len;
+    uint16_t n_children;
+    uint32_t first_child;       /* hijos contiguos, en orden de su primer byte */
+    uint32_t weight;            /* peso del título que termina aquí; 0: ninguno */
+    uint32_t max_weight;        /* máximo peso del subárbol */
+    uint32_t record;            /* registros del título: records[record], */
+    uint32_t n_records;         /* ... en orden del CSV (0 si no termina aquí) */
+} SuggestNode;
+
+typedef struct {
+    SuggestNode *nodes;         /* nodes[0] es la raíz (tramo vacío) */
+    long n_nodes;
+    char *labels;
+    size_t labels_size;
+    uint64_t *records;          /* offset en el CSV de cada registro, por título */
+    long n_records;
+    long n_titles;              /* títulos distintos */
+} Suggest;
+
+/* Construye el trie desde el CSV ya proyectado (csv, size). 0, o -1. */
+int suggest_build(Suggest *s, const char *csv, size_t size);
+void suggest_free(Suggest *s);
+
+/* Hasta k (<= SUGGEST_MAX_K) títulos que empiezan con prefix (se normaliza),
+ * de mayor a menor peso: deja el offset en el CSV de cada uno (su primer
+ * registro) en offsets y su peso en weights, y devuelve cuántos son. */
+int suggest_top(const Suggest *s, const char *prefix, int k, uint64_t *offsets, uint32_t *weights);
+
+#define FUZZY_MAX_EDITS 4
+
+/* Título a distancia de edición dist de la consulta. */
+typedef struct {
+    uint32_t node;              /* s->nodes[node]: sus registros y su peso */
+    int dist;
+} SuggestMatch;
+
+/* Hasta max títulos a distancia de Levenshtein <= k (<= FUZZY_MAX_EDITS) del
+ * título ya normalizado norm, de menor a mayor distancia y, a igual
+ * distancia, de mayor a menor peso. En *visited deja los nodos recorridos.
+ * Devuelve cuántos son, o -1 sin memoria. */
+int suggest_fuzzy(const Suggest *s, const char *norm, int k, SuggestMatch *out, int max, long *visited);
+
+#endif
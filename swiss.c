@@ -0,0 +1,261 @@
+/* swiss.c
+ * Índice exacto de direccionamiento abierto (ver swiss.h), estilo Swiss
+ * table:
+ *  - cada título normalizado da un hash de 64 bits h (wy64); h >> 7 elige
+ *    el grupo inicial y los 7 bits bajos son su byte de control
+ *  - el sondeo avanza de a grupos (g, g + 1, g + 3, g + 6, ...: triangular,
+ *    con n_groups potencia de 2 recorre todos) y termina en el primer grupo
+ *    con un slot libre; la ocupación máxima es 7/8
+ *  - un título repetido ocupa un slot por registro, todos con la misma clave
+ * Sin borrados y llenando siempre el primer slot libre, los slots ocupados
+ * de cada grupo son un prefijo y una consulta encuentra los registros en el
+ * orden en que se insertaron, que es el del CSV.
+ * Una búsqueda lee los 16 bytes de control del grupo (una línea de caché),
+ * y por cada byte que coincide el slot (otra línea) y, si el hash completo
+ * coincide, la clave. Las cadenas de index.bin, en cambio, saltan a un
+ * EntryDisk por entrada del bucket.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "swiss.h"
+#include "hash.h"
+#include "index.h"
+#include "util.h"
+
+#define MAX_RECORD_PREFIX 65536 /* el título va antes del abstract */
+#define ALIGN64(x) (((x) + 63) & ~(uint64_t)63)
+
+static inline uint8_t ctrl_of(uint64_t h) {
+    return (uint8_t)(h & 0x7f);
+}
+
+static inline uint64_t group_of(uint64_t h, uint64_t n_groups) {
+    return (h >> 7) & (n_groups - 1);
+}
+
+/* Bit i encendido si el byte de control i del grupo es b. */
+static inline uint32_t group_match(const uint8_t *ctrl, uint8_t b) {
+#ifdef __SSE2__
+    __m128i g = _mm_load_si128((const __m128i *)ctrl);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)b)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < SWISS_GROUP; ++i) mask |= (uint32_t)(ctrl[i] == b) << i;
+    return mask;
+#endif
+}
+
+static uint64_t title_hash(const char *norm) {
+    return hash_wy64(norm, strlen(norm), 0);
+}
+
+/* --- construcción --- */
+
+typedef struct {
+    uint8_t *ctrl;
+    SwissSlot *slots;
+    uint64_t n_groups;
+    char *keys;
+    uint64_t keys_size, keys_cap;
+    uint64_t n_records, n_keys;
+} Table;
+
+/* Agrega un registro; su clave se guarda sólo si no estaba. 0, o -1. */
+static int table_insert(Table *t, const char *norm, uint64_t offset, uint32_t row) {
+    uint64_t h = title_hash(norm);
+    uint64_t mask = t->n_groups - 1, g = group_of(h, t->n_groups);
+    int64_t key = -1;
+    for (uint64_t step = 1; ; g = (g + step++) & mask) {
+        const uint8_t *ctrl = t->ctrl + g * SWISS_GROUP;
+        for (uint32_t m = group_match(ctrl, ctrl_of(h)); m && key < 0; m &= m - 1) {
+            const SwissSlot *s = &t->slots[g * SWISS_GROUP + (uint64_t)__builtin_ctz(m)];
+            if (s->hash == h && strcmp(t->keys + s->key, norm) == 0) key = s->key;
+        }
+        uint32_t empty = group_match(ctrl, SWISS_EMPTY);
+        if (!empty) continue;
+
+        if (key < 0) {
+            size_t len = strlen(norm) + 1;
+            if (t->keys_size + len > t->keys_cap) {
+                uint64_t cap = t->keys_cap * 2 + len;
+                char *nk = realloc(t->keys, cap);
+                if (!nk) return -1;
+                t->keys = nk;
+                t->keys_cap = cap;
+            }
+            if (t->keys_size + len > UINT32_MAX) return -1;
+            memcpy(t->keys + t->keys_size, norm, len);
+            key = (int64_t)t->keys_size;
+            t->keys_size += len;
+            t->n_keys++;
+        }
+        uint64_t i = g * SWISS_GROUP + (uint64_t)__builtin_ctz(empty);
+        t->ctrl[i] = ctrl_of(h);
+        t->slots[i] = (SwissSlot){ h, offset, row, (uint32_t)key };
+        t->n_records++;
+        return 0;
+    }
+}
+
+/* Registros del CSV con título: cuántos hay, para dimensionar la tabla. */
+static uint64_t count_records(const char *csv, size_t size) {
+    uint64_t n = 0;
+    for (size_t off = 0, len; off < size && (len = csv_record_len(csv + off, size - off)) > 0; off += len) n++;
+    return n ? n - 1 : 0;   /* sin el encabezado */
+}
+
+int swiss_build(const char *csv_path, const char *swiss_path) {
+    int fd = open(csv_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { perror(csv_path); return -1; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        fprintf(stderr, "Archivo vacío o ilegible: %s\n", csv_path);
+        close(fd);
+        return -1;
+    }
+    const char *csv = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (csv == MAP_FAILED) { perror("mmap"); return -1; }
+    madvise((void *)csv, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    /* ocupación <= 7/8 con los registros contados de más (sin título) */
+    uint64_t n_max = count_records(csv, (size_t)st.st_size);
+    Table t = { 0 };
+    t.n_groups = 1;
+    while (t.n_groups * SWISS_GROUP * 7 < n_max * 8 + 1) t.n_groups *= 2;
+    uint64_t n_slots = t.n_groups * SWISS_GROUP;
+    t.ctrl = malloc(n_slots);
+    t.slots = calloc(n_slots, sizeof(SwissSlot));
+    t.keys_cap = 1 << 16;
+    t.keys = malloc(t.keys_cap);
+    char *rec = malloc(MAX_RECORD_PREFIX);
+    int rc = -1;
+    FILE *f = NULL;
+    if (!t.ctrl || !t.slots || !t.keys || !rec) { fprintf(stderr, "Sin memoria (swiss)\n"); goto out; }
+    memset(t.ctrl, SWISS_EMPTY, n_slots);
+
+    const char *p = csv, *end = csv + st.st_size;
+    uint32_t row = 0;
+    int header = 1;
+    while (p < end) {
+        size_t len = csv_record_len(p, (size_t)(end - p));
+        if (len == 0) break;
+        size_t copy = len < MAX_RECORD_PREFIX - 1 ? len : MAX_RECORD_PREFIX - 1;
+        memcpy(rec, p, copy);
+        rec[copy] = '\0';
+        uint64_t offset = (uint64_t)(p - csv);
+        p += len;
+        if (header) { header = 0; continue; }
+        row++;
+        /* misma clave que build_index: la columna 4 recortada a KEY_SIZE */
+        char key[KEY_SIZE], norm[KEY_SIZE];
+        if (!csv_get_column(rec, 4, key, sizeof(key)) || key[0] == '\0') continue;
+        hash_normalize(key, norm, sizeof(norm));
+        if (table_insert(&t, norm, offset, row - 1) != 0) { fprintf(stderr, "Sin memoria (swiss)\n"); goto out; }
+    }
+
+    SwissHeader hdr = { SWISS_MAGIC, SWISS_VERSION, t.n_groups, t.n_records, t.n_keys, 0, 0, 0, t.keys_size };
+    hdr.offset_ctrl = ALIGN64(sizeof(SwissHeader));
+    hdr.offset_slots = ALIGN64(hdr.offset_ctrl + n_slots);
+    hdr.offset_keys = hdr.offset_slots + sizeof(SwissSlot) * n_slots;
+
+    f = fopen(swiss_path, "wb");
+    if (!f) { perror(swiss_path); goto out; }
+    static const char zero[64];
+    int ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+             fwrite(zero, 1, hdr.offset_ctrl - sizeof(hdr), f) == hdr.offset_ctrl - sizeof(hdr) &&
+             fwrite(t.ctrl, 1, n_slots, f) == n_slots &&
+             fwrite(zero, 1, hdr.offset_slots - hdr.offset_ctrl - n_slots, f) ==
+                 hdr.offset_slots - hdr.offset_ctrl - n_slots &&
+             fwrite(t.slots, sizeof(SwissSlot), n_slots, f) == n_slots &&
+             fwrite(t.keys, 1, t.keys_size, f) == t.keys_size;
+    if (fclose(f) != 0 || !ok) {
+        f = NULL;
+        perror("Error escribiendo índice exacto");
+        goto out;
+    }
+    f = NULL;
+    printf("Índice exacto (swiss) generado: %llu registros, %llu títulos distintos, %llu grupos (ocupación %.0f%%), %.1f MB\n",
+           (unsigned long long)t.n_records, (unsigned long long)t.n_keys, (unsigned long long)t.n_groups,
+           100.0 * (double)t.n_records / (double)n_slots, (double)(hdr.offset_keys + t.keys_size) / 1e6);
+    rc = 0;
+out:
+    if (f) fclose(f);
+    munmap((void *)csv, (size_t)st.st_size);
+    free(rec); free(t.ctrl); free(t.slots); free(t.keys);
+    return rc;
+}
+
+/* --- consulta --- */
+
+int swiss_open(SwissMap *m, const char *swiss_path) {
+    memset(m, 0, sizeof(*m));
+    int fd = open(swiss_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SwissHeader)) { close(fd); return INDEX_ERR_FORMAT; }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) { perror("mmap"); return -1; }
+    m->base = p;
+    m->size = (size_t)st.st_size;
+    m->header = (const SwissHeader *)m->base;
+
+    const SwissHeader *h = m->header;
+    uint64_t n_slots = h->n_groups * SWISS_GROUP;
+    if (h->magic != SWISS_MAGIC || h->version != SWISS_VERSION || h->n_groups == 0 ||
+        (h->n_groups & (h->n_groups - 1)) != 0 || h->n_records >= n_slots || h->offset_ctrl % 64 != 0 ||
+        h->offset_ctrl + n_slots > h->offset_slots || h->offset_slots % 64 != 0 ||
+        h->offset_slots + sizeof(SwissSlot) * n_slots > h->offset_keys ||
+        h->offset_keys + h->keys_size > m->size || (h->keys_size && m->base[m->size - 1] != '\0')) {
+        fprintf(stderr, "Índice exacto con formato antiguo o dañado: %s\n", swiss_path);
+        swiss_close(m);
+        return INDEX_ERR_FORMAT;
+    }
+    m->ctrl = (const uint8_t *)(m->base + h->offset_ctrl);
+    m->slots = (const SwissSlot *)(m->base + h->offset_slots);
+    m->keys = m->base + h->offset_keys;
+    return 0;
+}
+
+void swiss_close(SwissMap *m) {
+    if (m->base) munmap((void *)m->base, m->size);
+    memset(m, 0, sizeof(*m));
+}
+
+long swiss_lookup(const SwissMap *m, const char *norm, uint64_t *offsets, long max, long *groups) {
+    const SwissHeader *hdr = m->header;
+    *groups = 0;
+    if (!hdr || hdr->n_records == 0) return 0;
+    uint64_t h = title_hash(norm);
+    uint64_t mask = hdr->n_groups - 1, g = group_of(h, hdr->n_groups);
+    uint32_t key = UINT32_MAX;  /* clave ya confirmada: las repetidas no se comparan */
+    long n = 0;
+    for (uint64_t step = 1; step <= hdr->n_groups; g = (g + step++) & mask) {
+        const uint8_t *ctrl = m->ctrl + g * SWISS_GROUP;
+        (*groups)++;
+        for (uint32_t match = group_match(ctrl, ctrl_of(h)); match; match &= match - 1) {
+            const SwissSlot *s = &m->slots[g * SWISS_GROUP + (uint64_t)__builtin_ctz(match)];
+            if (s->hash != h) continue;
+            if (s->key != key) {
+                if (s->key >= hdr->keys_size || strcmp(m->keys + s->key, norm) != 0) continue;
+                key = s->key;
+            }
+            if (n < max) offsets[n] = s->offset;
+            n++;
+        }
+        if (group_match(ctrl, SWISS_EMPTY)) break;
+    }
+    return n;
+}
@@ -0,0 +1,64 @@
+#ifndef SWISS_H
+#define SWISS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Índice exacto alternativo (opcional, -X): tabla de direccionamiento
+ * abierto estilo Swiss table sobre los títulos normalizados (hash_normalize),
+ * en lugar de las cadenas de EntryDisk de index.bin. Los slots van en grupos
+ * de SWISS_GROUP con un byte de control por slot (7 bits del hash, o
+ * SWISS_EMPTY); una consulta compara los 16 bytes de control de un grupo de
+ * una vez (SSE2) y sólo mira los slots cuyo byte coincide. Cada slot guarda
+ * el hash completo, el número de registro y su offset en el CSV; las claves
+ * van aparte, una vez por título distinto. Como index.mph, es estático y se
+ * reconstruye junto con index.bin. */
+
+#define SWISS_FILE "index.swt"
+#define SWISS_MAGIC 0x54575350  /* "PSWT" */
+#define SWISS_VERSION 1
+#define SWISS_GROUP 16          /* slots por grupo: 16 bytes de control */
+#define SWISS_EMPTY 0x80        /* byte de control de un slot libre */
+
+typedef struct {
+    uint32_t magic;             /* SWISS_MAGIC */
+    uint32_t version;           /* SWISS_VERSION */
+    uint64_t n_groups;          /* potencia de 2 */
+    uint64_t n_records;         /* slots ocupados: un registro por slot */
+    uint64_t n_keys;            /* títulos distintos */
+    uint64_t offset_ctrl;       /* uint8_t[n_groups * SWISS_GROUP], alineado a 64 */
+    uint64_t offset_slots;      /* SwissSlot[n_groups * SWISS_GROUP], alineado a 64 */
+    uint64_t offset_keys;       /* títulos normalizados terminados en '\0' */
+    uint64_t keys_size;
+} SwissHeader;
+
+typedef struct {
+    uint64_t hash;              /* wy64 del título normalizado */
+    uint64_t offset;            /* posición del registro en el CSV */
+    uint32_t row;               /* número de registro (sin el encabezado) */
+    uint32_t key;               /* offset del título en la sección de claves */
+} SwissSlot;
+
+typedef struct {
+    const char *base;           /* archivo proyectado (sólo lectura) */
+    size_t size;
+    const SwissHeader *header;
+    const uint8_t *ctrl;
+    const SwissSlot *slots;
+    const char *keys;
+} SwissMap;
+
+/* Construye swiss_path desde el CSV. 0, o -1. */
+int swiss_build(const char *csv_path, const char *swiss_path);
+
+/* Proyecta y valida swiss_path. 0; -1 si no se pudo abrir; INDEX_ERR_FORMAT
+ * (index.h) si es de otra versión o está dañado. */
+int swiss_open(SwissMap *m, const char *swiss_path);
+void swiss_close(SwissMap *m);
+
+/* Registros cuyo título normalizado es norm, en el orden del CSV: escribe
+ * hasta max offsets en offsets y devuelve cuántos hay (puede ser más que
+ * max). En *groups deja los grupos de control recorridos. */
+long swiss_lookup(const SwissMap *m, const char *norm, uint64_t *offsets, long max, long *groups);
+
+#endif
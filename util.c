@@ -0,0 +1,137 @@
+/* util.c
+ * Utilidades de texto, CSV y E/S compartidas (ver util.h).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>   /* strcasecmp, strncasecmp */
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "util.h"
+
+/* Portable case-insensitive substring search */
+char *ci_strcasestr(const char *haystack, const char *needle) {
+    if (!haystack || !needle) return NULL;
+    size_t needle_len = strlen(needle);
+    if (needle_len == 0) return (char *)haystack;
+    for (const char *p = haystack; *p; ++p) {
+        size_t rem = strlen(p);
+        if (rem < needle_len) return NULL;
+        if (strncasecmp(p, needle, needle_len) == 0) return (char *)p;
+    }
+    return NULL;
+}
+
+/* trim both ends */
+void trim_inplace(char *s) {
+    if (!s) return;
+    char *a = s;
+    while (*a && isspace((unsigned char)*a)) a++;
+    if (a != s) memmove(s, a, strlen(a)+1);
+    size_t n = strlen(s);
+    while (n > 0 && isspace((unsigned char)s[n-1])) { s[n-1] = '\0'; n--; }
+}
+
+/* CSV record length: stops at the first newline outside quotes */
+size_t csv_record_len(const char *p, size_t avail) {
+    int in_quotes = 0;
+    for (size_t i = 0; i < avail; ++i) {
+        if (p[i] == '"') in_quotes = !in_quotes;
+        else if (p[i] == '\n' && !in_quotes) return i + 1;
+    }
+    return avail;
+}
+
+/* Parse CSV column (1-based) with basic quote support */
+int csv_get_column(const char *line, int target_col, char *out, size_t out_sz) {
+    int col = 1;
+    const char *p = line;
+    while (*p && *p != '\n' && *p != '\r') {
+        if (col == target_col) {
+            if (*p == '"') {
+                p++; /* skip " */
+                size_t pos = 0;
+                while (*p) {
+                    if (*p == '"') {
+                        if (*(p+1) == '"') {
+                            if (pos + 1 < out_sz) out[pos++] = '"';
+                            p += 2;
+                            continue;
+                        } else { p++; break; } /* end quote */
+                    }
+                    if (pos + 1 < out_sz) out[pos++] = *p;
+                    p++;
+                }
+                out[pos] = '\0';
+                trim_inplace(out);
+                return 1;
+            } else {
+                const char *start = p;
+                while (*p && *p != ',' && *p != '\n' && *p != '\r') p++;
+                size_t len = (size_t)(p - start);
+                if (len >= out_sz) len = out_sz - 1;
+                memcpy(out, start, len);
+                out[len] = '\0';
+                trim_inplace(out);
+                return 1;
+            }
+        }
+
+        /* advance to next field */
+        if (*p == '"') {
+            p++;
+            while (*p) {
+                if (*p == '"' && *(p+1) != '"') { p++; break; }
+                if (*p == '"' && *(p+1) == '"') p += 2;
+                else p++;
+            }
+            if (*p == ',') { p++; col++; }
+        } else {
+            while (*p && *p != ',' && *p != '\n' && *p != '\r') p++;
+            if (*p == ',') { p++; col++; }
+        }
+    }
+    out[0] = '\0';
+    return 0;
+}
+
+/* Field name match ignoring case/spaces (small helper) */
+int field_is(const char *field, const char *target) {
+    if (!field || !target) return 0;
+    char a[128], b[128];
+    strncpy(a, field, sizeof(a)-1); a[sizeof(a)-1] = '\0'; trim_inplace(a);
+    strncpy(b, target, sizeof(b)-1); b[sizeof(b)-1] = '\0'; trim_inplace(b);
+    return strcasecmp(a, b) == 0;
+}
+
+/* Read/write exactly n bytes (pipes may split large messages) */
+ssize_t read_full(int fd, void *buf, size_t n) {
+    size_t got = 0;
+    while (got < n) {
+        ssize_t r = read(fd, (char *)buf + got, n - got);
+        if (r < 0) { if (errno == EINTR) continue; return -1; }
+        if (r == 0) break;
+        got += (size_t)r;
+    }
+    return (ssize_t)got;
+}
+
+ssize_t write_full(int fd, const void *buf, size_t n) {
+    size_t put = 0;
+    while (put < n) {
+        ssize_t w = write(fd, (const char *)buf + put, n - put);
+        if (w < 0) { if (errno == EINTR) continue; return -1; }
+        put += (size_t)w;
+    }
+    return (ssize_t)put;
+}
+
+long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
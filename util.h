@@ -0,0 +1,34 @@
+#ifndef UTIL_H
+#define UTIL_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Utilidades de texto, CSV y E/S compartidas por el daemon y sus módulos. */
+
+/* Búsqueda case-insensitive de subcadena; puntero a la ocurrencia o NULL. */
+char *ci_strcasestr(const char *haystack, const char *needle);
+
+/* Quita espacios en blanco al inicio y al final (in situ). */
+void trim_inplace(char *s);
+
+/* Copia la columna target_col (1-based) de una línea CSV en out, con soporte
+ * básico de comillas. Devuelve 1 si la columna existe, 0 si no. */
+int csv_get_column(const char *line, int target_col, char *out, size_t out_sz);
+
+/* Longitud del registro CSV que empieza en p (hasta avail bytes), incluido
+ * el '\n' final; los '\n' dentro de un campo entre comillas no lo terminan. */
+size_t csv_record_len(const char *p, size_t avail);
+
+/* Compara nombres de campo ignorando mayúsculas y espacios laterales. */
+int field_is(const char *field, const char *target);
+
+/* Lee/escribe exactamente n bytes (reintenta lecturas/escrituras parciales y
+ * EINTR). Devuelven los bytes transferidos o -1 en error. */
+ssize_t read_full(int fd, void *buf, size_t n);
+ssize_t write_full(int fd, const void *buf, size_t n);
+
+/* Reloj monotónico en nanosegundos (para plazos y mediciones). */
+long long now_ns(void);
+
+#endif